@@ -6,14 +6,29 @@
 
 #include "clang/AST/ASTConsumer.h"
 #include "clang/AST/EvaluatedExprVisitor.h"
+#include "clang/Frontend/ASTUnit.h"
 #include "clang/Frontend/CompilerInstance.h"
 #include "clang/Frontend/FrontendAction.h"
+#include "clang/Basic/DiagnosticOptions.h"
+#include "clang/Basic/FileManager.h"
+#include "clang/Serialization/PCHContainerOperations.h"
 #include "clang/Tooling/Tooling.h"
-#include <fstream>
+#include "llvm/Support/MemoryBuffer.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <mutex>
 
 using namespace clang;
 
+#include "Batch.h"
 #include "Environment.h"
+#include "IRInterpreter.h"
+#include "IRLowering.h"
+#include "IRPasses.h"
+#include "PhaseTimer.h"
+#include "ThreadPool.h"
+#include "VectorEngine.h"
 
 class InterpreterVisitor :
         public EvaluatedExprVisitor<InterpreterVisitor> {
@@ -27,6 +42,7 @@ public:
             /// For recursion
             return;
         }
+        STATS_VISIT(bop);
         VisitStmt(bop);
         mEnv->binop(bop);
     }
@@ -34,6 +50,7 @@ public:
         if (mEnv->timeToReturn()) {
             return;
         }
+        STATS_VISIT(expr);
         VisitStmt(expr);
         mEnv->declref(expr);
     }
@@ -41,6 +58,7 @@ public:
         if (mEnv->timeToReturn()) {
             return;
         }
+        STATS_VISIT(expr);
         VisitStmt(expr);
         mEnv->cast(expr);
     }
@@ -48,14 +66,11 @@ public:
         if (mEnv->timeToReturn()) {
             return;
         }
+        STATS_VISIT(expr);
         VisitStmt(expr);
-        mEnv->call(expr);
-        // For self-define function
-        FunctionDecl *callee = expr->getDirectCallee();
-        if (!callee->getName().equals("FREE") &&
-            !callee->getName().equals("MALLOC") &&
-            !callee->getName().equals("INPUT") &&
-            !callee->getName().equals("PRINT")) {
+        // For self-define function, unless its result was cached
+        if (mEnv->call(expr)) {
+            FunctionDecl *callee = expr->getDirectCallee();
             if (callee->getBody()) {
                 Visit(callee->getBody());
             }
@@ -66,12 +81,14 @@ public:
         if (mEnv->timeToReturn()) {
             return;
         }
+        STATS_VISIT(decl_stmt);
         mEnv->decl(decl_stmt);
     }
     virtual void VisitIfStmt(IfStmt * if_stmt) {
         if (mEnv->timeToReturn()) {
             return;
         }
+        STATS_VISIT(if_stmt);
         Expr * cond = if_stmt->getCond();
         if (mEnv->calculate(cond)) {
             Stmt * then_stmt = if_stmt->getThen();
@@ -89,6 +106,7 @@ public:
             return;
         }
         else {
+            STATS_VISIT(ret_stmt);
             Visit(ret_stmt->getRetValue());
             mEnv->returnStmt(ret_stmt);
         }
@@ -97,6 +115,7 @@ public:
         if (mEnv->timeToReturn()) {
             return;
         }
+        STATS_VISIT(while_stmt);
         Expr * cond = while_stmt->getCond();
         while(mEnv->calculate(cond)) {
             Visit(while_stmt->getBody());
@@ -106,6 +125,7 @@ public:
         if (mEnv->timeToReturn()) {
             return;
         }
+        STATS_VISIT(for_stmt);
         if (Stmt * init = for_stmt->getInit()) {
             VisitStmt(init);
         }
@@ -118,45 +138,473 @@ private:
     Environment * mEnv;
 };
 
+/// Lower the program to the IR, run the passes of --passes over it and link it.
+/// With report, the pass statistics and the IR are printed if they were asked for
+static void buildIR(const InterpreterOptions & options, const ProgramInfo & info, TranslationUnitDecl * decl,
+                    IRModule & module, PhaseTimer * timer, bool report) {
+    if (timer) {
+        timer->begin("lower");
+    }
+    IRLowering(info, module, options.ptr32).lower(decl);
+    if (timer) {
+        timer->begin("passes");
+    }
+    IRPassManager passes(options.inlineThreshold);
+    std::string unknown;
+    passes.parse(options.passes, unknown);
+    passes.run(module);
+    module.link();
+    /// A profile counts the plain instructions
+    size_t fused = options.superinsts && options.opProfile.empty() ? fuseSuperinsts(module) : 0;
+    if (report && !options.passStats.empty()) {
+        passes.print(llvm::errs(), options.passStats);
+        if (options.passStats == "table") {
+            llvm::errs() << "[SUPERINSTS] " << fused << " sequences fused\n";
+        }
+    }
+    if (report && options.dumpIR) {
+        module.print(llvm::errs());
+    }
+}
+
 class InterpreterConsumer : public ASTConsumer {
 public:
-    explicit InterpreterConsumer(const ASTContext& context) : mEnv(),
-                                                              mVisitor(context, &mEnv) {
+    /// With a job the program runs as part of a batch : its output and status go to the job
+    explicit InterpreterConsumer(const ASTContext& context, const InterpreterOptions & options, PhaseTimer * timer,
+                                 BatchJob * job)
+            : mEnv(options, job ? &job->output : NULL, job ? job->input : std::string()),
+              mVisitor(context, &mEnv), mOptions(options), mTimer(timer), mJob(job) {
     }
     ~InterpreterConsumer() override = default;
 
     void HandleTranslationUnit(clang::ASTContext &Context) override {
+        if (mJob && Context.getDiagnostics().hasErrorOccurred()) {
+            mJob->status = "compile-error";
+            return;
+        }
         TranslationUnitDecl * decl = Context.getTranslationUnitDecl();
-        mEnv.init(decl);
+        try {
+            if (mOptions.engine == "ir") {
+                runIR(decl);
+            }
+            else {
+                phase("init");
+                mEnv.init(decl);
 
-        FunctionDecl * entry = mEnv.getEntry();
-        mVisitor.VisitStmt(entry->getBody());
+                FunctionDecl * entry = mEnv.getEntry();
+                phase("execute");
+                mEnv.startProfiler();
+                mVisitor.VisitStmt(entry->getBody());
+                mEnv.flushOutput();
+                mEnv.stopProfiler(Context.getSourceManager());
+            }
+        }
+        catch (const InterpreterError & error) {
+            mEnv.stopProfiler(Context.getSourceManager());
+            if (mJob) {
+                mJob->status = "error";
+                mJob->error = error.what();
+            }
+            else {
+                llvm::errs() << error.what();
+            }
+            return;
+        }
+        if (mJob) {
+            mJob->status = "ok";
+            return;
+        }
+        phase("teardown");
+        mEnv.printMemoStats();
+        mEnv.printQuickenStats();
+        mEnv.printStats();
     }
 private:
+    void phase(const char * name) {
+        if (mTimer) {
+            mTimer->begin(name);
+        }
+    }
+
+    /// Run the program with --engine=ir instead of walking the AST
+    void runIR(TranslationUnitDecl * decl) {
+        ProgramInfo info;
+        info.analyze(decl, false, mOptions.ptr32);
+        IRModule module;
+        buildIR(mOptions, info, decl, module, mTimer, !mJob);
+        IRInterpreter interpreter(module, mOptions, mJob ? &mJob->output : NULL,
+                                  mJob ? mJob->input : std::string());
+        phase("init");
+        interpreter.init();
+        phase("execute");
+        interpreter.run();
+    }
+
     Environment mEnv;
     InterpreterVisitor mVisitor;
+    const InterpreterOptions & mOptions;
+    PhaseTimer * mTimer;
+    BatchJob * mJob;
 };
 
 class InterpreterClassAction : public ASTFrontendAction {
 public:
+    InterpreterClassAction(const InterpreterOptions & options, PhaseTimer * timer, BatchJob * job = NULL)
+            : mOptions(options), mTimer(timer), mJob(job) {
+    }
     std::unique_ptr<clang::ASTConsumer> CreateASTConsumer(
             clang::CompilerInstance &Compiler, llvm::StringRef InFile) override {
         return std::unique_ptr<clang::ASTConsumer>(
-                new InterpreterConsumer(Compiler.getASTContext()));
+                new InterpreterConsumer(Compiler.getASTContext(), mOptions, mTimer, mJob));
     }
+protected:
+    /// Called once the preprocessor and the consumer are set up, right before parsing.
+    /// Parsing and Sema are interleaved in clang, so they are timed as one phase.
+    bool BeginSourceFileAction(clang::CompilerInstance &Compiler) override {
+        if (mTimer) {
+            mTimer->begin("parse+sema");
+        }
+        return true;
+    }
+private:
+    const InterpreterOptions & mOptions;
+    PhaseTimer * mTimer;
+    BatchJob * mJob;
 };
 
-int main (int argc, char ** argv) {
-    if (argc > 1) {
-        std::ifstream code_file(argv[1]);
-        if (code_file.is_open()) {
-            std::string code((std::istreambuf_iterator<char>(code_file)), std::istreambuf_iterator<char>());
-            clang::tooling::runToolOnCode(std::unique_ptr<clang::FrontendAction>(new InterpreterClassAction), code);
+/// Run the action on the file at path, whose contents are already in source.
+/// The buffer is handed to the frontend without being copied, and the real path keeps
+/// diagnostics pointing at the file. The program is still parsed as C++ like runToolOnCode does.
+static bool runToolOnFile(std::unique_ptr<clang::FrontendAction> action, const std::string & path,
+                          const llvm::MemoryBuffer & source, clang::FileManager * files) {
+    std::vector<std::string> args;
+    args.push_back("clang-tool");
+    args.push_back("-fsyntax-only");
+    args.push_back("-xc++");
+    args.push_back(path);
+    clang::tooling::ToolInvocation invocation(args, std::move(action), files);
+    invocation.mapVirtualFile(path, source.getBuffer());
+    return invocation.run();
+}
+
+/// Parse and run one program of a batch, recording the outcome in the job
+static void runJob(const InterpreterOptions & options, BatchJob & job, clang::FileManager * files) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer> > code_file = llvm::MemoryBuffer::getFile(job.program);
+    if (!code_file) {
+        job.status = "unreadable";
+        job.error = code_file.getError().message();
+    }
+    else {
+        bool parsed = runToolOnFile(std::unique_ptr<clang::FrontendAction>(
+                new InterpreterClassAction(options, NULL, &job)), job.program, **code_file, files);
+        if (job.status.empty()) {
+            job.status = parsed ? "error" : "compile-error";
         }
-        else {
-            clang::tooling::runToolOnCode(std::unique_ptr<clang::FrontendAction>(new InterpreterClassAction), argv[1]);
+    }
+    job.wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/// Run every job on a work-stealing pool of the given size and write one result line per job,
+/// in the order of the jobs, as soon as all earlier ones are done
+static void runOrdered(unsigned workers, std::vector<BatchJob> & jobs, llvm::raw_ostream & results,
+                       const std::function<void(BatchJob &, unsigned)> & run) {
+    WorkStealingPool pool(workers);
+    std::mutex resultsLock;
+    std::vector<bool> finished(jobs.size(), false);
+    size_t nextResult = 0;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        pool.submit([&, i](unsigned worker) {
+            run(jobs[i], worker);
+            std::lock_guard<std::mutex> guard(resultsLock);
+            finished[i] = true;
+            while (nextResult < jobs.size() && finished[nextResult]) {
+                writeResult(results, jobs[nextResult]);
+                /// The output can be large, only the result line is kept
+                jobs[nextResult].output = std::string();
+                nextResult++;
+            }
+        });
+    }
+    pool.run();
+}
+
+static unsigned workerCount(const InterpreterOptions & options, size_t jobs) {
+    return std::max<size_t>(1, std::min<size_t>(options.jobs, jobs));
+}
+
+/// Run every program of the batch in this process on --jobs worker threads.
+/// Each program gets a fresh CompilerInstance and Environment, each worker its own FileManager,
+/// so the workers share nothing mutable but the ordered result writer.
+static int runBatch(const InterpreterOptions & options) {
+    std::vector<BatchJob> jobs;
+    for (const std::string & program : options.batchPrograms) {
+        jobs.push_back(BatchJob(program, options.input));
+    }
+    if (!options.manifest.empty() && !readManifest(options.manifest, jobs)) {
+        llvm::errs() << "[ERROR] Cannot Read Manifest: " << options.manifest << "\n";
+        return 1;
+    }
+    std::error_code ec;
+    llvm::raw_fd_ostream results(options.results, ec);
+    if (ec) {
+        llvm::errs() << "[ERROR] Cannot Write Results: " << options.results << "\n";
+        return 1;
+    }
+    unsigned workers = workerCount(options, jobs.size());
+    std::vector<llvm::IntrusiveRefCntPtr<clang::FileManager> > files;
+    for (unsigned i = 0; i < workers; i++) {
+        files.push_back(new clang::FileManager(clang::FileSystemOptions()));
+    }
+    runOrdered(workers, jobs, results, [&](BatchJob & job, unsigned worker) {
+        runJob(options, job, files[worker].get());
+    });
+    Environment::printStats(options);
+    return 0;
+}
+
+/// Parse and analyze the program once, then run it for every input file of --inputs on
+/// --jobs threads. The AST and the ProgramInfo are only read while the runs go on; each run
+/// has its own Environment, so its own stack, heap, GET stream and captured output.
+static int runInputs(const InterpreterOptions & options) {
+    std::vector<BatchJob> jobs;
+    if (!readInputList(options.inputs, options.program, jobs)) {
+        llvm::errs() << "[ERROR] Cannot Read Input List: " << options.inputs << "\n";
+        return 1;
+    }
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer> > code_file = llvm::MemoryBuffer::getFile(options.program);
+    if (!code_file) {
+        llvm::errs() << "[ERROR] Cannot Read Program: " << options.program << "\n";
+        return 1;
+    }
+    std::unique_ptr<clang::ASTUnit> unit = clang::tooling::buildASTFromCodeWithArgs(
+            (*code_file)->getBuffer(), std::vector<std::string>(1, "-xc++"), options.program);
+    if (!unit || unit->getASTContext().getDiagnostics().hasErrorOccurred()) {
+        llvm::errs() << "[ERROR] Cannot Compile Program: " << options.program << "\n";
+        return 1;
+    }
+    TranslationUnitDecl * decl = unit->getASTContext().getTranslationUnitDecl();
+    ProgramInfo info;
+    info.analyze(decl, options.memoize, options.ptr32);
+    if (!info.getEntry()) {
+        llvm::errs() << "[ERROR] No main In Program: " << options.program << "\n";
+        return 1;
+    }
+    std::error_code ec;
+    llvm::raw_fd_ostream results(options.results, ec);
+    if (ec) {
+        llvm::errs() << "[ERROR] Cannot Write Results: " << options.results << "\n";
+        return 1;
+    }
+    if (options.engine == "ir") {
+        /// Lowered and optimized once, every run only reads the module
+        IRModule module;
+        try {
+            buildIR(options, info, decl, module, NULL, true);
+        }
+        catch (const InterpreterError & error) {
+            llvm::errs() << error.what();
+            return 1;
+        }
+        runOrdered(workerCount(options, jobs.size()), jobs, results, [&](BatchJob & job, unsigned worker) {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            IRInterpreter interpreter(module, options, &job.output, job.input);
+            try {
+                interpreter.init();
+                interpreter.run();
+                job.status = "ok";
+            }
+            catch (const InterpreterError & error) {
+                job.status = "error";
+                job.error = error.what();
+            }
+            job.wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        });
+        return 0;
+    }
+    if (options.engine == "simt") {
+        /// Each task runs a group of --lanes consecutive inputs in lockstep, results stay in order
+        size_t groups = (jobs.size() + options.lanes - 1) / options.lanes;
+        WorkStealingPool pool(workerCount(options, groups));
+        for (size_t g = 0; g < groups; g++) {
+            pool.submit([&, g](unsigned worker) {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                size_t first = g * options.lanes;
+                std::vector<BatchJob *> lanes;
+                for (size_t i = first; i < std::min<size_t>(first + options.lanes, jobs.size()); i++) {
+                    lanes.push_back(&jobs[i]);
+                }
+                VectorEngine engine(info, lanes, options.ptr32);
+                engine.run(decl);
+                double wallMs = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - start).count();
+                for (BatchJob * lane : lanes) {
+                    lane->wallMs = wallMs;
+                }
+            });
+        }
+        pool.run();
+        for (BatchJob & job : jobs) {
+            writeResult(results, job);
         }
+        return 0;
+    }
+    runOrdered(workerCount(options, jobs.size()), jobs, results, [&](BatchJob & job, unsigned worker) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        Environment env(options, &job.output, job.input, &info);
+        InterpreterVisitor visitor(unit->getASTContext(), &env);
+        try {
+            env.init(decl);
+            visitor.VisitStmt(info.getEntry()->getBody());
+            env.flushOutput();
+            job.status = "ok";
+        }
+        catch (const InterpreterError & error) {
+            job.status = "error";
+            job.error = error.what();
+        }
+        job.wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    });
+    Environment::printStats(options);
+    return 0;
+}
+
+/// Set up an Environment for the ASTUnit with setup (init or a restore) and run main
+static void runUnit(const InterpreterOptions & options, clang::ASTUnit & unit, PhaseTimer & timer,
+                    const std::function<void(Environment &, TranslationUnitDecl *)> & setup) {
+    ASTContext & context = unit.getASTContext();
+    TranslationUnitDecl * decl = context.getTranslationUnitDecl();
+    Environment env(options);
+    InterpreterVisitor visitor(context, &env);
+    try {
+        timer.begin("init");
+        setup(env, decl);
+        if (!env.getEntry()) {
+            throw InterpreterError("[ERROR] No main In Program");
+        }
+        timer.begin("execute");
+        env.startProfiler();
+        visitor.VisitStmt(env.getEntry()->getBody());
+        env.flushOutput();
+        env.stopProfiler(context.getSourceManager());
+    }
+    catch (const InterpreterError & error) {
+        env.stopProfiler(context.getSourceManager());
+        llvm::errs() << error.what();
+        return;
+    }
+    timer.begin("teardown");
+    env.printMemoStats();
+    env.printQuickenStats();
+    env.printStats();
+}
+
+/// Parse the program into an ASTUnit, save it and the state after init, then run main
+static int saveSnapshot(const InterpreterOptions & options, PhaseTimer & timer) {
+    timer.begin("read");
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer> > code_file = llvm::MemoryBuffer::getFile(options.program);
+    if (!code_file) {
+        llvm::errs() << "[ERROR] Cannot Read Program: " << options.program << "\n";
+        return 1;
+    }
+    timer.begin("parse+sema");
+    std::unique_ptr<clang::ASTUnit> unit = clang::tooling::buildASTFromCodeWithArgs(
+            (*code_file)->getBuffer(), std::vector<std::string>(1, "-xc++"), options.program);
+    if (!unit || unit->getASTContext().getDiagnostics().hasErrorOccurred()) {
+        llvm::errs() << "[ERROR] Cannot Compile Program: " << options.program << "\n";
+        return 1;
+    }
+    timer.begin("save ast");
+    /// Save returns true on error
+    if (unit->Save(SnapshotState::astPath(options.saveSnapshot))) {
+        llvm::errs() << "[ERROR] Cannot Write Snapshot: " << SnapshotState::astPath(options.saveSnapshot) << "\n";
+        return 1;
+    }
+    runUnit(options, *unit, timer, [&](Environment & env, TranslationUnitDecl * decl) {
+        env.init(decl);
+        if (!env.saveState(decl).write(options.saveSnapshot)) {
+            throw InterpreterError("[ERROR] Cannot Write Snapshot");
+        }
+    });
+    return 0;
+}
+
+/// Load the AST and the post-init state of a snapshot and run main, skipping parsing and init
+static int restoreSnapshot(const InterpreterOptions & options, PhaseTimer & timer) {
+    timer.begin("read");
+    SnapshotState state;
+    if (!state.read(options.restore)) {
+        llvm::errs() << "[ERROR] Cannot Read Snapshot: " << options.restore << "\n";
+        return 1;
+    }
+    timer.begin("load ast");
+    llvm::IntrusiveRefCntPtr<clang::DiagnosticsEngine> diags =
+            clang::CompilerInstance::createDiagnostics(new clang::DiagnosticOptions());
+    /// The ASTReader of the unit keeps a reference to the container reader, it has to outlive unit
+    clang::RawPCHContainerReader reader;
+    std::unique_ptr<clang::ASTUnit> unit = clang::ASTUnit::LoadFromASTFile(
+            SnapshotState::astPath(options.restore), reader,
+            clang::ASTUnit::LoadEverything, diags, clang::FileSystemOptions());
+    if (!unit) {
+        llvm::errs() << "[ERROR] Cannot Read Snapshot: " << SnapshotState::astPath(options.restore) << "\n";
+        return 1;
+    }
+    runUnit(options, *unit, timer, [&](Environment & env, TranslationUnitDecl * decl) {
+        env.restoreState(decl, state);
+    });
+    return 0;
+}
+
+static void printPhaseTimes(const InterpreterOptions & options, PhaseTimer & timer) {
+    timer.end();
+    if (options.phaseTimes == "json") {
+        timer.printJSON(llvm::errs());
+    }
+    else if (!options.phaseTimes.empty()) {
+        timer.printTable(llvm::errs());
+    }
+}
+
+int main (int argc, char ** argv) {
+    InterpreterOptions options;
+    if (!options.parse(argc, argv)) {
+        InterpreterOptions::usage(argv[0]);
+        return 0;
+    }
+    if (options.engine == "ir") {
+        IRPassManager passes(options.inlineThreshold);
+        std::string unknown;
+        if (!passes.parse(options.passes, unknown)) {
+            llvm::errs() << "[ERROR] Unknown Pass: " << unknown << "\n";
+            return 0;
+        }
+    }
+    if (options.batch) {
+        return runBatch(options);
+    }
+    if (!options.inputs.empty()) {
+        return runInputs(options);
+    }
+    PhaseTimer timer;
+    if (!options.saveSnapshot.empty() || !options.restore.empty()) {
+        int status = options.restore.empty() ? saveSnapshot(options, timer) : restoreSnapshot(options, timer);
+        printPhaseTimes(options, timer);
+        return status;
+    }
+    timer.begin("read");
+    /// Large files are mmapped rather than read
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer> > code_file = llvm::MemoryBuffer::getFile(options.program);
+    if (code_file) {
+        timer.begin("frontend setup");
+        llvm::IntrusiveRefCntPtr<clang::FileManager> files(new clang::FileManager(clang::FileSystemOptions()));
+        runToolOnFile(std::unique_ptr<clang::FrontendAction>(new InterpreterClassAction(options, &timer)),
+                      options.program, **code_file, files.get());
+    }
+    else {
+        timer.begin("frontend setup");
+        clang::tooling::runToolOnCode(std::unique_ptr<clang::FrontendAction>(new InterpreterClassAction(options, &timer)), options.program);
     }
+    printPhaseTimes(options, timer);
     return 0;
 }
 
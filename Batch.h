@@ -0,0 +1,110 @@
+//
+// Created by Critizero on 2021/10/22.
+//
+
+#ifndef ASSIGN1_BATCH_H
+#define ASSIGN1_BATCH_H
+
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+/// One program of a batch run and what came out of it.
+/// Every program runs in a fresh Environment whose PRINT output is captured here.
+struct BatchJob {
+    std::string program;
+    /// File GET reads from, GET yields 0 if there is none
+    std::string input;
+    /// "ok", "error" (runtime error), "compile-error" or "unreadable"
+    std::string status;
+    std::string output;
+    /// Message of the runtime error
+    std::string error;
+    double wallMs;
+
+    BatchJob(const std::string & program, const std::string & input)
+            : program(program), input(input), status(), output(), error(), wallMs(0) {
+    }
+};
+
+/// Append one job per input file listed in path, all running program
+inline bool readInputList(const std::string & path, const std::string & program, std::vector<BatchJob> & jobs) {
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer> > buffer = llvm::MemoryBuffer::getFileOrSTDIN(path);
+    if (!buffer) {
+        return false;
+    }
+    llvm::StringRef rest = (*buffer)->getBuffer();
+    while (!rest.empty()) {
+        std::pair<llvm::StringRef, llvm::StringRef> line = rest.split('\n');
+        rest = line.second;
+        llvm::StringRef text = line.first.trim();
+        if (!text.empty() && !text.startswith("#")) {
+            jobs.push_back(BatchJob(program, text.str()));
+        }
+    }
+    return true;
+}
+
+/// Append the jobs of a manifest, one "program [input]" per line.
+/// Blank lines and lines starting with '#' are skipped. Return false if it cannot be read
+inline bool readManifest(const std::string & path, std::vector<BatchJob> & jobs) {
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer> > buffer = llvm::MemoryBuffer::getFileOrSTDIN(path);
+    if (!buffer) {
+        return false;
+    }
+    llvm::StringRef rest = (*buffer)->getBuffer();
+    while (!rest.empty()) {
+        std::pair<llvm::StringRef, llvm::StringRef> line = rest.split('\n');
+        rest = line.second;
+        llvm::StringRef text = line.first.trim();
+        if (text.empty() || text.startswith("#")) {
+            continue;
+        }
+        std::pair<llvm::StringRef, llvm::StringRef> fields = text.split(' ');
+        jobs.push_back(BatchJob(fields.first.str(), fields.second.trim().str()));
+    }
+    return true;
+}
+
+inline void writeJSONString(llvm::raw_ostream & os, llvm::StringRef s) {
+    os << '"';
+    for (char c : s) {
+        switch (c) {
+            case '"': os << "\\\""; break;
+            case '\\': os << "\\\\"; break;
+            case '\n': os << "\\n"; break;
+            case '\t': os << "\\t"; break;
+            case '\r': os << "\\r"; break;
+            default:
+                if ((unsigned char)c < 0x20) {
+                    os << llvm::format("\\u%04x", (unsigned char)c);
+                }
+                else {
+                    os << c;
+                }
+        }
+    }
+    os << '"';
+}
+
+/// One JSON line per run :
+/// {"program": ..., "input": ..., "status": ..., "output": ..., "error": ..., "wall_ms": ...}
+inline void writeResult(llvm::raw_ostream & os, const BatchJob & job) {
+    os << "{\"program\": ";
+    writeJSONString(os, job.program);
+    os << ", \"input\": ";
+    writeJSONString(os, job.input);
+    os << ", \"status\": ";
+    writeJSONString(os, job.status);
+    os << ", \"output\": ";
+    writeJSONString(os, job.output);
+    os << ", \"error\": ";
+    writeJSONString(os, job.error);
+    os << llvm::format(", \"wall_ms\": %.3f}\n", job.wallMs);
+}
+
+#endif //ASSIGN1_BATCH_H
@@ -0,0 +1,121 @@
+//
+// Created by Critizero on 2021/10/22.
+//
+
+#ifndef ASSIGN1_DATASEGMENT_H
+#define ASSIGN1_DATASEGMENT_H
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/Decl.h"
+#include "clang/AST/Expr.h"
+#include "llvm/ADT/DenseMap.h"
+
+#include "GuestMemory.h"
+
+using namespace clang;
+
+/// Layout and initial contents of the globals segment, computed once from the AST.
+/// Every global, scalar or constant array, gets an 8 byte aligned offset in the segment.
+/// The image holds what the constant initializers (initializer lists and string literals
+/// included) put there, so init lays out all globals with one copy of it.
+/// An initializer that is not a constant is left zero in the image and listed among the
+/// dynamic initializers, which init evaluates after the copy, in declaration order.
+class DataSegment {
+public:
+    struct DynamicInit {
+        int64_t offset;
+        const Type * type;
+        Expr * init;
+    };
+private:
+    llvm::DenseMap<const Decl *, int64_t> mOffsets;
+    std::string mImage;
+    std::vector<DynamicInit> mDynamic;
+    bool mPtr32;
+
+    /// Bytes of a value of type in the segment
+    int64_t size(const Type * type) const {
+        if (auto array = dyn_cast<ConstantArrayType>(type)) {
+            return array->getSize().getSExtValue() * size(array->getElementType().getTypePtr());
+        }
+        return GuestMemory::width(type, mPtr32);
+    }
+
+    /// Put the value of init for an object of type at offset into the image
+    void place(ASTContext & context, int64_t offset, const Type * type, Expr * init) {
+        init = init->IgnoreParens();
+        if (auto array = dyn_cast<ConstantArrayType>(type)) {
+            const Type * element = array->getElementType().getTypePtr();
+            int64_t length = array->getSize().getSExtValue();
+            int64_t stride = size(element);
+            if (auto list = dyn_cast<InitListExpr>(init)) {
+                for (unsigned i = 0; i < list->getNumInits() && i < length; i++) {
+                    place(context, offset + i * stride, element, list->getInit(i));
+                }
+            }
+            else if (auto str = dyn_cast<StringLiteral>(init)) {
+                if (stride == 1 && str->getCharByteWidth() == 1) {
+                    StringRef bytes = str->getString();
+                    memcpy(&mImage[offset], bytes.data(), std::min<int64_t>(bytes.size(), length));
+                }
+            }
+            return;
+        }
+        Expr::EvalResult result;
+        if (init->EvaluateAsInt(result, context)) {
+            int64_t value = result.Val.getInt().getExtValue();
+            memcpy(&mImage[offset], &value, GuestMemory::width(type, mPtr32));
+        }
+        else if (!type->isPointerType() || !init->isNullPointerConstant(context, Expr::NPC_ValueDependentIsNotNull)) {
+            DynamicInit dynamic = { offset, type, init };
+            mDynamic.push_back(dynamic);
+        }
+    }
+public:
+    DataSegment() : mOffsets(), mImage(), mDynamic(), mPtr32(false) {
+    }
+
+    /// The globals that live in the segment : integers, pointers and constant arrays
+    static bool isGlobal(const VarDecl * vdecl) {
+        const Type * type = vdecl->getType().getTypePtr();
+        return type->isIntegerType() || type->isPointerType() || isa<ConstantArrayType>(type);
+    }
+
+    void analyze(TranslationUnitDecl * unit, bool ptr32) {
+        mPtr32 = ptr32;
+        ASTContext & context = unit->getASTContext();
+        for (TranslationUnitDecl::decl_iterator i = unit->decls_begin(), e = unit->decls_end(); i != e; ++ i) {
+            VarDecl * vdecl = dyn_cast<VarDecl>(*i);
+            if (!vdecl || !isGlobal(vdecl)) {
+                continue;
+            }
+            const Type * type = vdecl->getType().getTypePtr();
+            int64_t offset = mImage.size();
+            mImage.resize(offset + ((size(type) + 7) & ~(int64_t)7), 0);
+            mOffsets[vdecl] = offset;
+            if (vdecl->hasInit()) {
+                place(context, offset, type, vdecl->getInit());
+            }
+        }
+    }
+
+    /// Offset of a global in the segment, -1 if decl is not one
+    int64_t offset(const Decl * decl) const {
+        auto it = mOffsets.find(decl);
+        return it == mOffsets.end() ? -1 : it->second;
+    }
+    const std::string & image() const {
+        return mImage;
+    }
+    const std::vector<DynamicInit> & dynamic() const {
+        return mDynamic;
+    }
+};
+
+#endif //ASSIGN1_DATASEGMENT_H
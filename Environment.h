@@ -9,8 +9,11 @@
 //===----------------------------------------------------------------------===//
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 #include <iostream>
 #include <exception>
+#include <memory>
+#include <stdexcept>
 
 #include "clang/AST/ASTConsumer.h"
 #include "clang/AST/Decl.h"
@@ -19,21 +22,52 @@
 #include "clang/Frontend/FrontendAction.h"
 #include "clang/Tooling/Tooling.h"
 
+#include "ExprSlots.h"
+#include "GuestIO.h"
+#include "GuestMemory.h"
+#include "Memo.h"
+#include "Options.h"
+#include "Profiler.h"
+#include "ProgramInfo.h"
+#include "Quicken.h"
+#include "Snapshot.h"
+#include "Stats.h"
+
 using namespace clang;
 
+/// Runtime error of the guest program, the message is in the usual "[ERROR] ..." form.
+/// It is caught in the AST consumer and never unwinds through clang.
+class InterpreterError : public std::runtime_error {
+public:
+    explicit InterpreterError(const char * msg) : std::runtime_error(msg) {
+    }
+};
+
 class StackFrame {
     /// StackFrame maps Variable Declaration to Value
     /// Which are either integer or addresses (also represented using an Integer(64bits) value)
     std::map<Decl*, int64_t> mVars;
-    std::map<Stmt*, int64_t> mExprs;
-    /// The current stmt
+    /// Values of the expression temporaries, indexed by their slot in the function
+    const ExprSlots * mSlots;
+    std::vector<int64_t> mExprs;
+    /// Top of the guest stack when the frame was pushed, the local arrays are above it
+    int64_t mStackMark;
+    /// The function executing in this frame and its current stmt
+    FunctionDecl * mFunc;
     Stmt * mPC;
     /// Store return value
     int64_t mRetValue;
     /// To decide weather to return : for recursion
     bool mRet;
+    /// Callee and arguments of a memoized call, the result is cached on return
+    FunctionDecl * mMemoFunc;
+    std::vector<int64_t> mMemoArgs;
+    /// Tells the frames of one Environment apart, a quickened local array element is valid in one
+    uint64_t mSerial;
 public:
-    StackFrame() : mVars(), mExprs(), mPC(), mRet(false) {
+    StackFrame(const ExprSlots * slots, FunctionDecl * func, int64_t stackMark, uint64_t serial) : mVars(), mSlots(slots),
+            mExprs(slots->size(func), 0), mStackMark(stackMark), mFunc(func), mPC(), mRet(false), mMemoFunc(NULL), mMemoArgs(),
+            mSerial(serial) {
     }
 
     void bindDecl(Decl* decl, int64_t val) {
@@ -43,22 +77,36 @@ public:
         assert (mVars.find(decl) != mVars.end());
         return mVars.find(decl)->second;
     }
+    /// Zeroed guest stack storage for a local array, reused when the declaration runs again in a loop.
+    /// Return false on a guest stack overflow
+    bool bindArray(Decl * decl, GuestMemory & memory, int64_t bytes) {
+        auto it = mVars.find(decl);
+        if (it != mVars.end()) {
+            memset(memory.at(it->second, bytes), 0, bytes);
+            return true;
+        }
+        int64_t addr = memory.pushStack(bytes);
+        mVars[decl] = addr;
+        return addr != 0;
+    }
+    int64_t getStackMark() {
+        return mStackMark;
+    }
     void bindStmt(Stmt * stmt, int64_t val) {
-        mExprs[stmt] = val;
+        bindSlot(mSlots->slot(stmt), val);
+    }
+    void bindSlot(unsigned slot, int64_t val) {
+        assert (slot < mExprs.size());
+        mExprs[slot] = val;
     }
     int64_t getStmtVal(Stmt * stmt) {
-        assert (mExprs.find(stmt) != mExprs.end());
-        return mExprs[stmt];
+        unsigned slot = mSlots->slot(stmt);
+        assert (slot < mExprs.size());
+        return mExprs[slot];
     }
     void setPC(Stmt * stmt) {
         mPC = stmt;
     }
-    bool exprExits(Stmt * stmt) {
-        return mExprs.find(stmt) != mExprs.end();
-    }
-    void pushStmt(Stmt * stmt, int64_t val) {
-        mExprs.insert(std::pair<Stmt *, int64_t>(stmt, val));
-    }
     void setRetVal(int64_t val) {
         mRetValue = val;
     }
@@ -74,38 +122,90 @@ public:
     Stmt * getPC() {
         return mPC;
     }
+    void setFunc(FunctionDecl * func) {
+        mFunc = func;
+    }
+    FunctionDecl * getFunc() {
+        return mFunc;
+    }
+    void setMemoKey(FunctionDecl * func, std::vector<int64_t> args) {
+        mMemoFunc = func;
+        mMemoArgs = std::move(args);
+    }
+    FunctionDecl * getMemoFunc() {
+        return mMemoFunc;
+    }
+    const std::vector<int64_t> & getMemoArgs() {
+        return mMemoArgs;
+    }
+    uint64_t getSerial() {
+        return mSerial;
+    }
 };
 
 /// Heap maps address to a value
+/// Blocks are carved from the heap segment of the guest memory, freed blocks are reused by
+/// later blocks of the same (8 byte rounded) size
 
 class Heap {
 private:
+    GuestMemory & mGuest;
     std::map<int64_t, int64_t> mMemory;
+    /// Freed blocks by size
+    std::map<int64_t, std::vector<int64_t> > mFreed;
 public:
-    Heap() : mMemory() {
-    }
-    char * Malloc(int64_t size) {
-        char * p = new char[size];
-        int64_t ptr = (int64_t)p;
-        mMemory[ptr] = size;
-        return p;
+    explicit Heap(GuestMemory & guest) : mGuest(guest), mMemory(), mFreed() {
     }
-    void Free (int64_t addr) {
-        char * p = (char *)addr;
-        if (mMemory.find(addr) != mMemory.end()) {
-            delete  p;
-            mMemory.erase(addr);
+    /// Guest address of a new block, 0 if the heap is full
+    int64_t Malloc(int64_t size) {
+        int64_t bytes = size > 0 ? (size + 7) & ~(int64_t)7 : 8;
+        int64_t ptr = 0;
+        auto freed = mFreed.find(bytes);
+        if (freed != mFreed.end() && !freed->second.empty()) {
+            ptr = freed->second.back();
+            freed->second.pop_back();
         }
         else {
-            llvm::errs()  << "[ERROR] Not A Valid Address";
-            exit(0);
+            ptr = mGuest.growHeap(bytes);
+            if (!ptr) {
+                return 0;
+            }
         }
+        mMemory[ptr] = bytes;
+        STATS_MALLOC(size);
+        return ptr;
+    }
+    /// Live blocks, address to size
+    const std::map<int64_t, int64_t> & blocks() const {
+        return mMemory;
+    }
+    /// Return false if addr was not returned by Malloc
+    bool Free (int64_t addr) {
+        auto it = mMemory.find(addr);
+        if (it != mMemory.end()) {
+            mFreed[it->second].push_back(addr);
+            mMemory.erase(it);
+            STATS_FREE();
+            return true;
+        }
+        return false;
+    }
+    /// Put a saved block back at its address, return false if that cannot be done
+    bool restore(int64_t addr, const std::string & bytes) {
+        if (!mGuest.extendHeapTo(addr + (int64_t)bytes.size()) || !mGuest.at(addr, bytes.size())) {
+            return false;
+        }
+        memcpy(mGuest.at(addr, bytes.size()), bytes.data(), bytes.size());
+        mMemory[addr] = bytes.size();
+        return true;
     }
 };
 
 
 class Environment {
     std::vector<StackFrame> mStack;
+    /// Guest address space, the heap and the local and global arrays live in it
+    GuestMemory mMemory;
     Heap mHeap;
 
     FunctionDecl * mFree;				/// Declartions to the built-in functions
@@ -114,14 +214,109 @@ class Environment {
     FunctionDecl * mOutput;
 
     FunctionDecl * mEntry;
+
+    const InterpreterOptions & mOptions;
+    /// Builtins, expression slots and pure functions, either shared or analyzed by init
+    const ProgramInfo * mInfo;
+    ProgramInfo mOwnInfo;
+    /// Cached results of pure functions, used with --memoize
+    MemoCache mMemo;
+    /// Guest stack sampler, used with --profile
+    SamplingProfiler mProfiler;
+    /// Output of PRINT
+    OutputBuffer mOut;
+    /// Input of GET in batch mode, GET prompts and reads stdin otherwise
+    InputReader mIn;
+    std::string mInputPath;
+    /// PRINT output is captured and GET never prompts
+    bool mCaptured;
+    /// Quickened form of every expression node by its id, empty with --no-quicken
+    std::vector<QuickOp> mQuick;
+    QuickenStats mQuickStats;
+    /// Frames pushed so far
+    uint64_t mFrames;
+
+    /// Report a runtime error of the guest program and stop it
+    void fatal(const char * msg) {
+        mOut.flush();
+        throw InterpreterError(msg);
+    }
+
+    /// Load a value of the given type from guest memory
+    int64_t load(int64_t addr, const Type * type) {
+        int64_t value = 0;
+        if (!mMemory.load(addr, mMemory.width(type), type->isSignedIntegerType(), value)) {
+            fatal("[ERROR] Invalid Memory Access");
+        }
+        return value;
+    }
+    void store(int64_t addr, const Type * type, int64_t value) {
+        if (!mMemory.store(addr, mMemory.width(type), value)) {
+            fatal("[ERROR] Invalid Memory Access");
+        }
+    }
+    /// Load and store with the width and signedness in access
+    int64_t load(int64_t addr, const QuickOp & access) {
+        int64_t value = 0;
+        if (!mMemory.load(addr, access.width, access.isSigned, value)) {
+            fatal("[ERROR] Invalid Memory Access");
+        }
+        return value;
+    }
+    void store(int64_t addr, const QuickOp & access, int64_t value) {
+        if (!mMemory.store(addr, access.width, value)) {
+            fatal("[ERROR] Invalid Memory Access");
+        }
+    }
+
+    /// Width and signedness of a value of type in guest memory
+    QuickOp access(const Type * type) {
+        QuickOp op = QuickOp();
+        op.width = mMemory.width(type);
+        op.isSigned = type->isSignedIntegerType();
+        return op;
+    }
+
+    /// The quickened form of the expression with entry, NULL with --no-quicken
+    QuickOp * quickOp(const ExprSlots::Entry & entry) {
+        return mQuick.empty() ? NULL : &mQuick[entry.id];
+    }
+
+    /// Track the current stmt and take a sample if the profiling timer fired
+    void setPC(Stmt * stmt) {
+        mStack.back().setPC(stmt);
+        if (gProfileTicks) {
+            std::vector<ProfileFrame> stack;
+            stack.reserve(mStack.size());
+            for (StackFrame & frame : mStack) {
+                stack.push_back(ProfileFrame(frame.getFunc(), frame.getPC()));
+            }
+            mProfiler.record(stack);
+        }
+    }
 public:
-    /// Get the declartions to the built-in functions
-    Environment() : mStack(), mHeap(), mFree(NULL), mMalloc(NULL), mInput(NULL), mOutput(NULL), mEntry(NULL) {
+    /// With capture, PRINT appends to *capture and GET reads input (nothing if it is empty)
+    /// instead of prompting, as one program of a batch.
+    /// With info, the analyses of an already analyzed program are used instead of running them in init;
+    /// the environment only reads it and the AST, so many can run the same program on different threads
+    explicit Environment(const InterpreterOptions & options, std::string * capture = NULL,
+                         const std::string & input = std::string(), const ProgramInfo * info = NULL)
+            : mStack(), mMemory(options.ptr32), mHeap(mMemory), mFree(NULL), mMalloc(NULL),
+            mInput(NULL), mOutput(NULL), mEntry(NULL), mOptions(options), mInfo(info), mOwnInfo(),
+            mMemo(options.memoCapacity), mProfiler(),
+            mOut(options.printTo == "stdout" ? STDOUT_FILENO : STDERR_FILENO, capture),
+            mIn(), mInputPath(capture ? input : options.input), mCaptured(capture != NULL),
+            mQuick(), mQuickStats(), mFrames(0) {
     }
 
     /// Set return value
     void bindReturnValue(CallExpr * call) {
         int64_t ret = mStack.back().getRetVal();
+        if (FunctionDecl * func = mStack.back().getMemoFunc()) {
+            mMemo.insert(func, mStack.back().getMemoArgs(), ret);
+        }
+        STATS_RETURN();
+        mMemory.popStack(mStack.back().getStackMark());
         mStack.pop_back();
         mStack.back().bindStmt(call, ret);
     }
@@ -139,38 +334,190 @@ public:
 //        llvm::errs() << "Exit returnStmt\n";
     }
 
-    /// Initialize the Environment
+private:
+    /// Open the input, get the program's analyses and push the first frame
+    void prepare(TranslationUnitDecl * unit) {
+        if (!mInputPath.empty()) {
+            if (!mIn.open(mInputPath)) {
+                fatal("[ERROR] Cannot Read Input");
+            }
+        }
+        else if (mCaptured) {
+            mIn.openEmpty();
+        }
+
+        if (!mInfo) {
+            mOwnInfo.analyze(unit, mOptions.memoize, mOptions.ptr32);
+            mInfo = &mOwnInfo;
+        }
+        mFree = mInfo->getFree();
+        mMalloc = mInfo->getMalloc();
+        mInput = mInfo->getInput();
+        mOutput = mInfo->getOutput();
+        mEntry = mInfo->getEntry();
+
+        if (mOptions.quicken) {
+            mQuick.assign(mInfo->getSlots().count(), QuickOp());
+        }
+        /// The frame of main, the dynamic global initializers also evaluate in it
+        mStack.push_back(StackFrame(&mInfo->getSlots(), mEntry, mMemory.stackTop(), ++ mFrames));
+    }
+
+    /// Where the global ref names lives and, for a scalar, its width and signedness
+    QuickOp global(DeclRefExpr * ref, const ExprSlots::Entry & entry) {
+        QuickOp * quick = quickOp(entry);
+        if (quick && quick->kind != QK_None) {
+            mQuickStats.quick++;
+            return *quick;
+        }
+        mQuickStats.generic++;
+        const Type * type = ref->getType().getTypePtr();
+        QuickOp op = QuickOp();
+        if (isa<ConstantArrayType>(type)) {
+            op.kind = QK_GlobalArray;
+        }
+        else {
+            op = access(type);
+            op.kind = QK_GlobalScalar;
+        }
+        op.base = mMemory.globalsBegin() + entry.global;
+        if (quick) {
+            *quick = op;
+        }
+        return op;
+    }
+
+    /// Value of the variable ref names, entry is ref's entry in the expression slots : locals are
+    /// bound in the frame, globals were resolved to their place in the globals segment by the
+    /// analysis and a global array evaluates to its address
+    int64_t readVar(DeclRefExpr * ref, const ExprSlots::Entry & entry) {
+        if (entry.global >= 0) {
+            QuickOp op = global(ref, entry);
+            return op.kind == QK_GlobalArray ? op.base : load(op.base, op);
+        }
+        return mStack.back().getDeclVal(ref->getFoundDecl());
+    }
+    int64_t readVar(DeclRefExpr * ref) {
+        return readVar(ref, mInfo->getSlots().entry(ref));
+    }
+    void writeVar(DeclRefExpr * ref, int64_t val) {
+        const ExprSlots::Entry & entry = mInfo->getSlots().entry(ref);
+        if (entry.global >= 0) {
+            QuickOp op = global(ref, entry);
+            store(op.base, op, val);
+        }
+        else {
+            mStack.back().bindDecl(ref->getFoundDecl(), val);
+        }
+    }
+public:
+    /// Initialize the Environment : copy the data segment image into the globals segment,
+    /// then evaluate the initializers that are not constants
     void init(TranslationUnitDecl * unit) {
 //        llvm::errs() << "Into init\n";
+        prepare(unit);
 
-        /// This frame is used to store the global var.
-        mStack.push_back(StackFrame());
-
-        for (TranslationUnitDecl::decl_iterator i =unit->decls_begin(), e = unit->decls_end(); i != e; ++ i) {
-//            i->dumpColor();
-            if (FunctionDecl * fdecl = dyn_cast<FunctionDecl>(*i) ) {
-                if (fdecl->getName().equals("FREE")) mFree = fdecl;
-                else if (fdecl->getName().equals("MALLOC")) mMalloc = fdecl;
-                else if (fdecl->getName().equals("GET")) mInput = fdecl;
-                else if (fdecl->getName().equals("PRINT")) mOutput = fdecl;
-                else if (fdecl->getName().equals("main")) mEntry = fdecl;
+        const DataSegment & data = mInfo->getData();
+        if (!mMemory.loadGlobals(data.image())) {
+            fatal("[ERROR] Out Of Guest Memory");
+        }
+        for (const DataSegment::DynamicInit & dynamic : data.dynamic()) {
+            store(mMemory.globalsBegin() + dynamic.offset, dynamic.type, calculate(dynamic.init));
+        }
+//        llvm::errs() << "Exit init\n";
+    }
+
+    /// The state init leaves behind : the globals segment and the heap, with main as the entry
+    SnapshotState saveState(TranslationUnitDecl * unit) {
+        SnapshotState state;
+        state.pointerWidth = mMemory.ptr32() ? 4 : 8;
+        uint32_t index = 0;
+        for (TranslationUnitDecl::decl_iterator i = unit->decls_begin(), e = unit->decls_end(); i != e; ++ i, ++ index) {
+            if (*i == mEntry) {
+                state.entry = index;
             }
-            else if(VarDecl * vdecl = dyn_cast<VarDecl>(*i)){
-                if (vdecl->getType().getTypePtr()->isIntegerType() ||
-                    vdecl->getType().getTypePtr()->isCharType() ||
-                    vdecl->getType().getTypePtr()->isPointerType() ||
-                    vdecl->getType().getTypePtr()->isVoidType()){
-                    if(vdecl->hasInit()){
-                        mStack.back().bindDecl(vdecl, calculate(vdecl->getInit()));
-                    }
-                    else{
-                        mStack.back().bindDecl(vdecl, 0);
-                    }
-                }
-                /// !Todo : Supply for Arrays' initialization
+        }
+        state.data = mMemory.globals();
+        for (auto & block : mHeap.blocks()) {
+            SnapshotState::Block saved = { block.first, std::string(mMemory.at(block.first, block.second), block.second) };
+            state.heap.push_back(saved);
+        }
+        return state;
+    }
+
+    /// Instead of init : rebuild the globals segment and the heap from a snapshot of the same program.
+    /// Guest addresses are offsets into the guest memory, so every block goes back where it was
+    /// and no pointer has to change
+    void restoreState(TranslationUnitDecl * unit, const SnapshotState & state) {
+        prepare(unit);
+        std::vector<Decl *> decls(unit->decls_begin(), unit->decls_end());
+        if (state.entry >= decls.size() || decls[state.entry] != mEntry ||
+            state.pointerWidth != (mMemory.ptr32() ? 4u : 8u) ||
+            state.data.size() != mInfo->getData().image().size() || !mMemory.loadGlobals(state.data)) {
+            fatal("[ERROR] Snapshot Does Not Match The Program");
+        }
+        for (const SnapshotState::Block & block : state.heap) {
+            if (!mHeap.restore(block.addr, block.bytes)) {
+                fatal("[ERROR] Snapshot Does Not Match The Program");
             }
         }
-//        llvm::errs() << "Exit init\n";
+    }
+
+    /// Write out what PRINT has buffered so far
+    void flushOutput() {
+        mOut.flush();
+    }
+
+    void startProfiler() {
+        if (!mOptions.profile.empty()) {
+            mProfiler.start(mOptions.profileHz);
+        }
+    }
+
+    /// Write the folded stacks and print where the samples landed
+    void stopProfiler(const SourceManager & sm) {
+        if (!mOptions.profile.empty()) {
+            mProfiler.stop();
+            mProfiler.write(mOptions.profile, sm);
+            mProfiler.printSummary(llvm::errs(), sm);
+        }
+    }
+
+    /// Print the execution counters, used with --stats
+    void printStats() {
+        printStats(mOptions);
+    }
+
+    /// The counters are process wide, a batch prints them once at the end
+    static void printStats(const InterpreterOptions & options) {
+        if (options.stats.empty()) {
+            return;
+        }
+#ifdef INTERP_STATS
+        if (options.stats == "json") {
+            ExecStats::get().printJSON(llvm::errs());
+        }
+        else {
+            ExecStats::get().printTable(llvm::errs());
+        }
+#else
+        llvm::errs() << "\n[WARN] Built Without Stats, Reconfigure With -DENABLE_STATS=ON\n";
+#endif
+    }
+
+    /// Report how well the result cache did
+    void printMemoStats() {
+        if (mOptions.memoize) {
+            llvm::errs() << "\n[MEMO] " << mInfo->getPurity().size() << " pure functions\n";
+            mMemo.print(llvm::errs());
+        }
+    }
+
+    /// Report how many operations ran quickened, used with --quicken-stats
+    void printQuickenStats() {
+        if (mOptions.quickenStats) {
+            mQuickStats.print(llvm::errs());
+        }
     }
 
     FunctionDecl * getEntry() {
@@ -179,7 +526,96 @@ public:
         return mEntry;
     }
 
-    /// Binary operation
+    /// The operation bop does, derived from its opcode and the type of its left operand;
+    /// scale is the pointee width of pointer arithmetic
+    QuickKind arithmetic(BinaryOperator * bop, int32_t & scale) {
+        const Type * left = bop->getLHS()->getType().getTypePtr();
+        switch (bop->getOpcode()) {
+            case BO_Add:
+            case BO_Sub:
+                if (left->isPointerType()) {
+                    scale = mMemory.width(left->getPointeeType().getTypePtr());
+                    return bop->getOpcode() == BO_Add ? QK_AddPtr : QK_SubPtr;
+                }
+                return bop->getOpcode() == BO_Add ? QK_Add : QK_Sub;
+            case BO_Mul:
+                return QK_Mul;
+            case BO_Div:
+                return QK_Div;
+            case BO_LT:
+                return QK_Lt;
+            case BO_GT:
+                return QK_Gt;
+            case BO_EQ:
+                return QK_Eq;
+            default:
+                fatal("[ERROR] Unknown Operator");
+                return QK_None;
+        }
+    }
+
+    /// Address of the element array refers to and, in op, its width and signedness. Return false
+    /// for a subscript of something other than an array variable. The index is evaluated first.
+    /// A quickened subscript skips the decl and type checks, and of a local array also the lookup
+    /// of its address, guarded by the frame the address was found in
+    bool element(ArraySubscriptExpr * array, int64_t & addr, QuickOp & op) {
+        QuickOp * quick = quickOp(mInfo->getSlots().entry(array));
+        if (quick && quick->kind != QK_None) {
+            int64_t idx = calculate(array->getRHS());
+            if (quick->kind == QK_ElemLocal && quick->frame != mStack.back().getSerial()) {
+                /// Another frame, with its own array : look it up and quicken again
+                mQuickStats.guardFailures++;
+                mQuickStats.generic++;
+                quick->base = readVar(dyn_cast<DeclRefExpr>(array->getLHS()->IgnoreImpCasts()));
+                quick->frame = mStack.back().getSerial();
+            }
+            else {
+                mQuickStats.quick++;
+            }
+            addr = quick->base + idx * quick->width;
+            op = *quick;
+            return true;
+        }
+        DeclRefExpr * ref = dyn_cast<DeclRefExpr>(array->getLHS()->IgnoreImpCasts());
+        if (!ref) {
+            return false;
+        }
+        int64_t idx = calculate(array->getRHS());
+        VarDecl * var = dyn_cast<VarDecl>(ref->getFoundDecl());
+        const ConstantArrayType * type = var ? dyn_cast<ConstantArrayType>(var->getType().getTypePtr()) : NULL;
+        if (!type) {
+            return false;
+        }
+        mQuickStats.generic++;
+        op = access(type->getElementType().getTypePtr());
+        op.base = readVar(ref);
+        addr = op.base + idx * op.width;
+        if (quick) {
+            op.kind = mInfo->getSlots().entry(ref).global >= 0 ? QK_ElemGlobal : QK_ElemLocal;
+            op.frame = mStack.back().getSerial();
+            *quick = op;
+        }
+        return true;
+    }
+
+    /// Width and signedness of the value the dereference uop reads or writes
+    QuickOp deref(UnaryOperator * uop) {
+        QuickOp * quick = quickOp(mInfo->getSlots().entry(uop));
+        if (quick && quick->kind != QK_None) {
+            mQuickStats.quick++;
+            return *quick;
+        }
+        mQuickStats.generic++;
+        QuickOp op = access(uop->getType().getTypePtr());
+        op.kind = QK_Deref;
+        if (quick) {
+            *quick = op;
+        }
+        return op;
+    }
+
+    /// Binary operation. An arithmetic operator runs the generic path the first time, which
+    /// finds out from the types what it does, and is quickened to that from then on
     void binop(BinaryOperator *bop) {
 //        llvm::errs() << "Into binop\n";
         Expr * left = bop->getLHS();
@@ -188,102 +624,94 @@ public:
         if (bop->isAssignmentOp()) {
             if (DeclRefExpr * declexpr = dyn_cast<DeclRefExpr>(left)) {
                 int64_t val = calculate(right);
-                Decl * decl = declexpr->getFoundDecl();
-                mStack.back().bindDecl(decl, val);
+                writeVar(declexpr, val);
                 mStack.back().bindStmt(bop, val);
             }
             else if (auto array = dyn_cast<ArraySubscriptExpr>(left)) {
-                if (DeclRefExpr * declexpr = dyn_cast<DeclRefExpr>(array->getLHS()->IgnoreImpCasts())) {
-                    Decl * decl = declexpr->getFoundDecl();
+                if (isa<DeclRefExpr>(array->getLHS()->IgnoreImpCasts())) {
                     int64_t val = calculate(right);
-                    int64_t idx = calculate(array->getRHS());
-                    if (VarDecl * vdecl = dyn_cast<VarDecl>(decl)) {
-                        if (auto arr = dyn_cast<ConstantArrayType>(vdecl->getType().getTypePtr())) {
-                            if (arr->getElementType().getTypePtr()->isIntegerType()) {
-                                int64_t p = mStack.back().getDeclVal(vdecl);
-                                *((int64_t *)p + idx) = (int64_t)val;
-                            }
-                            else if (arr->getElementType().getTypePtr()->isCharType()) {
-                                int64_t p = mStack.back().getDeclVal(vdecl);
-                                *((char *)p + idx) = (char)val;
-                            }
-                            else{
-                                int64_t p = mStack.back().getDeclVal(vdecl);
-                                *((int64_t *)p + idx) = (int64_t)val;
-                            }
-                        }
+                    int64_t addr;
+                    QuickOp op;
+                    if (element(array, addr, op)) {
+                        store(addr, op, val);
                     }
                 }
             }
             else if (auto uaexpr = dyn_cast<UnaryOperator>(left)) {
                 int64_t val = calculate(right);
                 int64_t addr = calculate(uaexpr->getSubExpr());
-                *((int64_t *)addr) = val;
+                store(addr, deref(uaexpr), val);
             }
         }
         else {
-            auto op = bop->getOpcode();
+            const ExprSlots::Entry & entry = mInfo->getSlots().entry(bop);
+            QuickOp * quick = quickOp(entry);
+            QuickKind kind;
+            int32_t scale = 0;
+            if (quick && quick->kind != QK_None) {
+                mQuickStats.quick++;
+                kind = quick->kind;
+                scale = quick->width;
+            }
+            else {
+                mQuickStats.generic++;
+                kind = arithmetic(bop, scale);
+                if (quick) {
+                    quick->kind = kind;
+                    quick->width = scale;
+                }
+            }
             int64_t vleft, vright, vresult;
-            switch (op) {
-                case BO_Add: {
-                    if (left->getType().getTypePtr()->isPointerType()) {
-                        int64_t base = calculate(left);
-                        vresult = base + 8 * calculate(right);
-                    }
-                    else {
-                        /// int64_t sss = expr(right);
-                        vresult = calculate(left) + calculate(right);
-                    }
+            switch (kind) {
+                case QK_Add: {
+                    vresult = calculate(left) + calculate(right);
                     break;
                 }
-                case BO_Sub: {
-                    if (left->getType().getTypePtr()->isPointerType()) {
-                        int64_t base = calculate(left);
-                        vresult = base - 8 * calculate(right);
-                    }
-                    else {
-                        vresult = calculate(left) - calculate(right);
-                    }
+                case QK_AddPtr: {
+                    int64_t base = calculate(left);
+                    vresult = base + scale * calculate(right);
+                    break;
+                }
+                case QK_Sub: {
+                    vresult = calculate(left) - calculate(right);
+                    break;
+                }
+                case QK_SubPtr: {
+                    int64_t base = calculate(left);
+                    vresult = base - scale * calculate(right);
                     break;
                 }
-                case BO_Mul: {
+                case QK_Mul: {
                     vresult = calculate(left) * calculate(right);
                     break;
                 }
-                case BO_Div: {
+                case QK_Div: {
                     vright = calculate(right);
                     if (vright == 0){
-                        llvm::errs()  << "[ERROR] Dived By Zero";
-                        exit(0);
+                        fatal("[ERROR] Dived By Zero");
                     }
                     vleft = calculate(left);
                     vresult = vleft / vright;
                     break;
                 }
-                case BO_LT: {
+                case QK_Lt: {
                     vresult = calculate(left) < calculate(right);
                     break;
                 }
-                case BO_GT: {
+                case QK_Gt: {
                     vresult = calculate(left) > calculate(right);
                     break;
                 }
-                case BO_EQ: {
+                case QK_Eq: {
                     vresult = calculate(left) == calculate(right);
                     break;
                 }
                 default: {
-                    llvm::errs()  << "[ERROR] Unknown Operator";
-                    exit(0);
+                    fatal("[ERROR] Unknown Operator");
                     break;
                 }
             }
-            if (mStack.back().exprExits(bop)) {
-                mStack.back().bindStmt(bop, vresult);
-            }
-            else {
-                mStack.back().pushStmt(bop, vresult);
-            }
+            mStack.back().bindSlot(entry.slot, vresult);
         }
 //        llvm::errs() << "Exit binop\n";
     }
@@ -294,20 +722,20 @@ public:
         auto s_expr = uop->getSubExpr();
         switch(op) {
             case UO_Minus: {
-                mStack.back().pushStmt(uop, -1 * calculate(s_expr));
+                mStack.back().bindStmt(uop, -1 * calculate(s_expr));
                 break;
             }
             case UO_Plus: {
-                mStack.back().pushStmt(uop, calculate(s_expr));
+                mStack.back().bindStmt(uop, calculate(s_expr));
                 break;
             }
             case UO_Deref: {
-                mStack.back().pushStmt(uop, *(int64_t *)calculate(s_expr));
+                int64_t addr = calculate(s_expr);
+                mStack.back().bindStmt(uop, load(addr, deref(uop)));
                 break;
             }
             default: {
-                llvm::errs()  << "[ERROR] Unknown Operator";
-                exit(0);
+                fatal("[ERROR] Unknown Operator");
                 break;
             }
         }
@@ -334,26 +762,9 @@ public:
                 else {
                     if (auto array = dyn_cast<ConstantArrayType>(var_decl->getType().getTypePtr())) {
                         int64_t length = array->getSize().getSExtValue();
-                        if (array->getElementType().getTypePtr()->isIntegerType()) {
-                            int64_t *p = new int64_t[length];
-                            for (int64_t i = 0; i < length; i++) {
-                                p[i] = 0;
-                            }
-                            mStack.back().bindDecl(var_decl, (int64_t)p);
-                        }
-                        else if (array->getElementType().getTypePtr()->isCharType()) {
-                            char *p = new char[length];
-                            for (int64_t i = 0; i < length; i++) {
-                                p[i] = 0;
-                            }
-                            mStack.back().bindDecl(var_decl, (int64_t)p);
-                        }
-                        else {
-                            int64_t *p = new int64_t[length];
-                            for (int64_t i = 0; i < length; i++) {
-                                p[i] = 0;
-                            }
-                            mStack.back().bindDecl(var_decl, (int64_t)p);
+                        int64_t bytes = length * mMemory.width(array->getElementType().getTypePtr());
+                        if (!mStack.back().bindArray(var_decl, mMemory, bytes)) {
+                            fatal("[ERROR] Guest Stack Overflow");
                         }
                     }
                 }
@@ -364,21 +775,12 @@ public:
 
     void declref(DeclRefExpr * decl_ref) {
 //        llvm::errs() << "Into declref\n";
-        mStack.back().setPC(decl_ref);
-        if (decl_ref->getType()->isIntegerType()) {
-            Decl* decl = decl_ref->getFoundDecl();
-            int64_t val = mStack.back().getDeclVal(decl);
-            mStack.back().bindStmt(decl_ref, val);
-        }
-        else if (decl_ref->getType()->isPointerType()) {
-            Decl * decl = decl_ref->getFoundDecl();
-            int64_t val = mStack.back().getDeclVal(decl);
-            mStack.back().bindStmt(decl_ref, val);
-        }
-        else if (decl_ref->getType()->isArrayType()) {
-            Decl * decl = decl_ref->getFoundDecl();
-            int64_t val = mStack.back().getDeclVal(decl);
-            mStack.back().bindStmt(decl_ref, val);
+        setPC(decl_ref);
+        if (decl_ref->getType()->isIntegerType() || decl_ref->getType()->isPointerType() ||
+            decl_ref->getType()->isArrayType()) {
+            /// One lookup gives both the slot and, for a global, where it lives
+            const ExprSlots::Entry & entry = mInfo->getSlots().entry(decl_ref);
+            mStack.back().bindSlot(entry.slot, readVar(decl_ref, entry));
         }
 //        llvm::errs() << "Exit declref\n";
     }
@@ -386,7 +788,7 @@ public:
     void cast(CastExpr * cast_expr) {
 //        llvm::errs() << "Into cast\n";
         Expr *  c_expr = cast_expr->IgnoreImpCasts();
-        mStack.back().setPC(cast_expr);
+        setPC(cast_expr);
         if (c_expr->getType()->isIntegerType()) {
             //expr(c_expr);
             //int64_t val = mStack.back().getStmtVal(c_expr);
@@ -407,48 +809,74 @@ public:
 //        llvm::errs() << "Exit cast\n";
     }
 
-    /// Function Call
-    void call(CallExpr * call_expr) {
+    /// Function Call, return true if a frame was pushed for the callee's body
+    bool call(CallExpr * call_expr) {
 //        llvm::errs() << "Into call\n";
-        mStack.back().setPC(call_expr);
+        setPC(call_expr);
         int64_t val = 0;
         FunctionDecl *callee = call_expr->getDirectCallee();
         if (callee == mInput) {
-            llvm::errs() << "Please Input an Integer Value : ";
-            scanf("%ld", &val);
+            if (mIn.isOpen()) {
+                mIn.readInt(val);
+            }
+            else {
+                /// The prompt has to come after everything printed before it
+                mOut.flush();
+                llvm::errs() << "Please Input an Integer Value : ";
+                scanf("%ld", &val);
+            }
 
             mStack.back().bindStmt(call_expr, val);
         } else if (callee == mOutput) {
             Expr *decl = call_expr->getArg(0);
             val = mStack.back().getStmtVal(decl);
-            llvm::errs() << val;
+            mOut.writeInt(val);
         } else if (callee == mMalloc) {
             Expr *decl = call_expr->getArg(0);
-            int64_t addr = (int64_t) mHeap.Malloc(calculate(decl));
+            int64_t addr = mHeap.Malloc(calculate(decl));
+            if (!addr) {
+                fatal("[ERROR] Out Of Guest Memory");
+            }
             mStack.back().bindStmt(call_expr, addr);
         } else if (callee == mFree) {
             Expr *decl = call_expr->getArg(0)->IgnoreImpCasts();
             if (auto sub_expr = dyn_cast<CStyleCastExpr>(decl)) {
                 decl = sub_expr->getSubExpr()->IgnoreImpCasts();
             }
-            mHeap.Free(mStack.back().getStmtVal(decl));
+            if (!mHeap.Free(mStack.back().getStmtVal(decl))) {
+                fatal("[ERROR] Not A Valid Address");
+            }
         } else {
             std::vector<int64_t> params;
             for (auto b = call_expr->arg_begin(), e = call_expr->arg_end(); b != e; b++) {
                 params.push_back(calculate(*b));
             }
-            mStack.emplace_back(StackFrame());
+            bool memoize = mOptions.memoize && mInfo->getPurity().isPure(callee);
+            if (memoize && mMemo.lookup(callee, params, val)) {
+                STATS_CALL(callee, false);
+                mStack.back().bindStmt(call_expr, val);
+                return false;
+            }
+            STATS_CALL(callee, true);
+            mStack.emplace_back(StackFrame(&mInfo->getSlots(), callee, mMemory.stackTop(), ++ mFrames));
+            STATS_DEPTH(mStack.size());
             int64_t idx = 0;
             for (auto i = callee->param_begin(), j = callee->param_end(); i != j; i++) {
                 mStack.back().bindDecl(*i, params[idx++]);
             }
+            if (memoize) {
+                mStack.back().setMemoKey(callee, std::move(params));
+            }
+            return true;
         }
 //        llvm::errs() << "Exit call\n";
+        return false;
     }
 
     int64_t calculate(Expr * request) {
 //        llvm::errs() << "Into expr\n";
         request = request->IgnoreImpCasts();
+        STATS_CALCULATE(request);
         if (auto exp = dyn_cast<IntegerLiteral>(request)) {
             return exp->getValue().getSExtValue();
         }
@@ -476,45 +904,20 @@ public:
         }
         else if (auto exp = dyn_cast<UnaryExprOrTypeTraitExpr>(request)) {
             if (exp->getKind() == UETT_SizeOf) {
-                if (exp->getArgumentType()->isIntegerType()) {
-                    return sizeof(int64_t);
-                }
-                else if (exp->getArgumentType()->isPointerType()) {
-                    return sizeof(int64_t *);
-                }
-                else if (exp->getArgumentType()->isCharType()) {
-                    return sizeof(char);
+                if (exp->getArgumentType()->isIntegerType() || exp->getArgumentType()->isPointerType()) {
+                    return mMemory.width(exp->getArgumentType().getTypePtr());
                 }
             }
         }
         else if (auto exp = dyn_cast<ArraySubscriptExpr>(request)) {
-            if (DeclRefExpr * decl_ref = dyn_cast<DeclRefExpr>(exp->getLHS()->IgnoreImpCasts())) {
-                Decl * decl = decl_ref->getFoundDecl();
-                int64_t idx = calculate(exp->getRHS());
-                if (VarDecl * v_decl = dyn_cast<VarDecl>(decl)) {
-                    if(auto array = dyn_cast<ConstantArrayType>(v_decl->getType().getTypePtr())) {
-                        if (array->getElementType().getTypePtr()->isIntegerType()) {
-                            int64_t * p = (int64_t *)mStack.back().getDeclVal(v_decl);
-                            int64_t val = p[idx];
-                            return val;
-                        }
-                        else if (array->getElementType().getTypePtr()->isIntegerType()) {
-                            char * p = (char *)mStack.back().getDeclVal(v_decl);
-                            int64_t val = (int64_t)p[idx];
-                            return val;
-                        }
-                        else {
-                            int64_t * p = (int64_t *)mStack.back().getDeclVal(v_decl);
-                            int64_t val = p[idx];
-                            return val;
-                        }
-                    }
-                }
+            int64_t addr;
+            QuickOp op;
+            if (element(exp, addr, op)) {
+                return load(addr, op);
             }
         }
         else {
-            llvm::errs() << "[ERROR] Unknown Expr";
-            exit(0);
+            fatal("[ERROR] Unknown Expr");
         }
 //        llvm::errs() << "Exit expr\n";
         return 0;
@@ -0,0 +1,106 @@
+//
+// Created by Critizero on 2021/10/22.
+//
+
+#ifndef ASSIGN1_EXPRSLOTS_H
+#define ASSIGN1_EXPRSLOTS_H
+
+#include <assert.h>
+
+#include "clang/AST/Decl.h"
+#include "clang/AST/RecursiveASTVisitor.h"
+#include "llvm/ADT/DenseMap.h"
+
+#include "DataSegment.h"
+
+using namespace clang;
+
+/// Numbers the expressions of every function once, so a frame keeps the values of
+/// its expression temporaries in a fixed array instead of a map that grows as it runs.
+/// main shares the first frame with the global initializers, so they share a numbering.
+/// A reference to a global is resolved here as well : its entry carries the global's offset
+/// in the globals segment, so reading or writing it from any frame is one indexed access.
+/// Every expression also gets an id unique in the program, for state kept per expression node.
+class ExprSlots {
+public:
+    struct Entry {
+        unsigned slot;
+        /// 0 .. count() - 1 over the whole program
+        unsigned id;
+        /// Offset in the globals segment of the global a DeclRefExpr names, -1 otherwise
+        int64_t global;
+    };
+private:
+    llvm::DenseMap<const Stmt *, Entry> mSlots;
+    llvm::DenseMap<const FunctionDecl *, unsigned> mSizes;
+    unsigned mCount;
+
+    class Numbering : public RecursiveASTVisitor<Numbering> {
+        llvm::DenseMap<const Stmt *, Entry> & mSlots;
+        const DataSegment & mData;
+        unsigned mNext;
+        unsigned & mCount;
+    public:
+        Numbering(llvm::DenseMap<const Stmt *, Entry> & slots, const DataSegment & data, unsigned first, unsigned & count)
+                : mSlots(slots), mData(data), mNext(first), mCount(count) {
+        }
+        bool VisitExpr(Expr * expr) {
+            DeclRefExpr * ref = dyn_cast<DeclRefExpr>(expr);
+            Entry entry = { mNext++, mCount++, ref ? mData.offset(ref->getDecl()) : -1 };
+            mSlots[expr] = entry;
+            return true;
+        }
+        unsigned next() {
+            return mNext;
+        }
+    };
+public:
+    ExprSlots() : mSlots(), mSizes(), mCount(0) {
+    }
+
+    void analyze(TranslationUnitDecl * unit, FunctionDecl * entry, const DataSegment & data) {
+        Numbering globals(mSlots, data, 0, mCount);
+        for (TranslationUnitDecl::decl_iterator i = unit->decls_begin(), e = unit->decls_end(); i != e; ++ i) {
+            if (VarDecl * vdecl = dyn_cast<VarDecl>(*i)) {
+                if (vdecl->hasInit()) {
+                    globals.TraverseStmt(vdecl->getInit());
+                }
+            }
+        }
+        for (TranslationUnitDecl::decl_iterator i = unit->decls_begin(), e = unit->decls_end(); i != e; ++ i) {
+            FunctionDecl * fdecl = dyn_cast<FunctionDecl>(*i);
+            if (!fdecl || !fdecl->isThisDeclarationADefinition()) {
+                continue;
+            }
+            bool isEntry = entry && fdecl->getCanonicalDecl() == entry->getCanonicalDecl();
+            Numbering numbering(mSlots, data, isEntry ? globals.next() : 0, mCount);
+            numbering.TraverseStmt(fdecl->getBody());
+            mSizes[fdecl->getCanonicalDecl()] = numbering.next();
+        }
+        if (!entry) {
+            mSizes[NULL] = globals.next();
+        }
+    }
+
+    /// Number of expression slots of a frame running func
+    unsigned size(FunctionDecl * func) const {
+        auto it = mSizes.find(func ? func->getCanonicalDecl() : NULL);
+        return it == mSizes.end() ? 0 : it->second;
+    }
+
+    /// Number of expressions in the program
+    unsigned count() const {
+        return mCount;
+    }
+
+    unsigned slot(const Stmt * stmt) const {
+        return entry(stmt).slot;
+    }
+    const Entry & entry(const Stmt * stmt) const {
+        auto it = mSlots.find(stmt);
+        assert (it != mSlots.end());
+        return it->second;
+    }
+};
+
+#endif //ASSIGN1_EXPRSLOTS_H
@@ -0,0 +1,175 @@
+//
+// Created by Critizero on 2021/10/22.
+//
+
+#ifndef ASSIGN1_GUESTIO_H
+#define ASSIGN1_GUESTIO_H
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <memory>
+#include <string>
+
+#include "llvm/Support/MemoryBuffer.h"
+
+/// Buffered output of PRINT.
+/// Integers are formatted two digits at a time into a large buffer, which is
+/// written with one syscall when it fills up or is flushed explicitly.
+/// In batch mode the output is captured into a string instead.
+class OutputBuffer {
+    static const size_t kSize = 1 << 16;
+
+    int mFd;
+    std::string * mCapture;
+    std::unique_ptr<char[]> mBuffer;
+    size_t mUsed;
+
+    static const char * digitPairs() {
+        return "00010203040506070809"
+               "10111213141516171819"
+               "20212223242526272829"
+               "30313233343536373839"
+               "40414243444546474849"
+               "50515253545556575859"
+               "60616263646566676869"
+               "70717273747576777879"
+               "80818283848586878889"
+               "90919293949596979899";
+    }
+public:
+    /// Write to fd, or append to *capture if it is given
+    explicit OutputBuffer(int fd, std::string * capture = NULL)
+            : mFd(fd), mCapture(capture), mBuffer(new char[kSize]), mUsed(0) {
+    }
+    ~OutputBuffer() {
+        flush();
+    }
+    OutputBuffer(const OutputBuffer &) = delete;
+    OutputBuffer & operator=(const OutputBuffer &) = delete;
+
+    void writeAll(const char * data, size_t size) {
+        if (mCapture) {
+            mCapture->append(data, size);
+            return;
+        }
+        size_t done = 0;
+        while (done < size) {
+            ssize_t n = ::write(mFd, data + done, size - done);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+            done += n;
+        }
+    }
+
+    void flush() {
+        writeAll(mBuffer.get(), mUsed);
+        mUsed = 0;
+    }
+
+    void write(const char * data, size_t size) {
+        if (mUsed + size > kSize) {
+            flush();
+            if (size > kSize) {
+                writeAll(data, size);
+                return;
+            }
+        }
+        memcpy(mBuffer.get() + mUsed, data, size);
+        mUsed += size;
+    }
+
+    void writeInt(int64_t val) {
+        char tmp[20];
+        char * end = tmp + sizeof(tmp);
+        char * p = end;
+        uint64_t u = val < 0 ? 0 - (uint64_t)val : (uint64_t)val;
+        const char * pairs = digitPairs();
+        while (u >= 100) {
+            const char * pair = pairs + (u % 100) * 2;
+            u /= 100;
+            *--p = pair[1];
+            *--p = pair[0];
+        }
+        if (u >= 10) {
+            *--p = pairs[u * 2 + 1];
+            *--p = pairs[u * 2];
+        }
+        else {
+            *--p = (char)('0' + u);
+        }
+        if (val < 0) {
+            *--p = '-';
+        }
+        write(p, end - p);
+    }
+};
+
+/// Non-interactive input of GET.
+/// The whole input file (or stdin) is mapped once and integers are parsed from it
+/// in place, without a prompt or a scanf call per value.
+class InputReader {
+    std::unique_ptr<llvm::MemoryBuffer> mBuffer;
+    const char * mPos;
+    const char * mEnd;
+public:
+    InputReader() : mBuffer(), mPos(NULL), mEnd(NULL) {
+    }
+
+    /// Map path, "-" reads all of stdin. Return false if it cannot be read
+    bool open(const std::string & path) {
+        llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer> > buffer =
+                llvm::MemoryBuffer::getFileOrSTDIN(path, -1, false);
+        if (!buffer) {
+            return false;
+        }
+        mBuffer = std::move(*buffer);
+        mPos = mBuffer->getBufferStart();
+        mEnd = mBuffer->getBufferEnd();
+        return true;
+    }
+
+    /// GET reads nothing, used when a batch program has no input
+    void openEmpty() {
+        mBuffer = llvm::MemoryBuffer::getMemBuffer("");
+        mPos = mBuffer->getBufferStart();
+        mEnd = mBuffer->getBufferEnd();
+    }
+
+    bool isOpen() {
+        return mBuffer != nullptr;
+    }
+
+    /// Parse the next integer like scanf("%ld") : skip white space, then an optional sign and digits.
+    /// Return false at the end of the input or if something else comes first, which is left unread
+    /// so that every later GET fails on it too, as scanf does
+    bool readInt(int64_t & val) {
+        const char * p = mPos;
+        while (p < mEnd && isspace((unsigned char)*p)) {
+            p++;
+        }
+        mPos = p;
+        const char * digits = p < mEnd && (*p == '-' || *p == '+') ? p + 1 : p;
+        if (digits == mEnd || !(*digits >= '0' && *digits <= '9')) {
+            return false;
+        }
+        bool negative = *p == '-';
+        p = digits;
+        uint64_t u = 0;
+        while (p < mEnd && *p >= '0' && *p <= '9') {
+            u = u * 10 + (*p - '0');
+            p++;
+        }
+        mPos = p;
+        val = negative ? (int64_t)(0 - u) : (int64_t)u;
+        return true;
+    }
+};
+
+#endif //ASSIGN1_GUESTIO_H
@@ -0,0 +1,215 @@
+//
+// Created by Critizero on 2021/10/22.
+//
+
+#ifndef ASSIGN1_GUESTMEMORY_H
+#define ASSIGN1_GUESTMEMORY_H
+
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <new>
+#include <string>
+
+#include "clang/AST/Type.h"
+
+/// The guest's address space : one virtual region reserved up front. Guest pointers are offsets
+/// into it, so 0 is NULL and every load and store is base + offset after a bounds check.
+///   [0, kGuard)           never accessible, catches NULL and small offsets from it
+///   globals (kGlobals)    the globals, laid out by init from the data segment image
+///   stack (kStack)        local arrays, released when their frame returns
+///   heap (up to the end)  MALLOC blocks
+/// The region is reserved without access and pages become accessible as a segment grows,
+/// so an environment only costs the memory its program touches.
+/// Values in guest memory take the size of their C type (int 4, char 1, pointers 8) and are
+/// stored little endian like on the host. With 32-bit pointers the region is capped at 4 GiB
+/// and pointers take 4 bytes.
+class GuestMemory {
+    struct Segment {
+        int64_t begin;
+        /// End of what is allocated, accesses must stay below it
+        int64_t top;
+        /// End of the accessible pages
+        int64_t mapped;
+        int64_t end;
+    };
+
+    static const int64_t kGuard = 1 << 16;
+    static const int64_t kGlobals = (int64_t)64 << 20;
+    static const int64_t kStack = (int64_t)256 << 20;
+    /// Pages are made accessible this many bytes at a time
+    static const int64_t kChunk = 1 << 16;
+
+    char * mBase;
+    int64_t mSize;
+    bool mPtr32;
+    Segment mGlobals;
+    Segment mStack;
+    Segment mHeap;
+
+    static Segment segment(int64_t begin, int64_t end) {
+        Segment s = { begin, begin, begin, end };
+        return s;
+    }
+
+    /// Allocate bytes (rounded up to 8) at the top of s, return 0 if it is full
+    int64_t grow(Segment & s, int64_t bytes) {
+        bytes = (bytes + 7) & ~(int64_t)7;
+        if (bytes < 0 || bytes > s.end - s.top) {
+            return 0;
+        }
+        int64_t addr = s.top;
+        if (s.top + bytes > s.mapped) {
+            int64_t mapped = (s.top + bytes + kChunk - 1) / kChunk * kChunk;
+            if (mapped > s.end) {
+                mapped = s.end;
+            }
+            if (mprotect(mBase + s.mapped, mapped - s.mapped, PROT_READ | PROT_WRITE) != 0) {
+                return 0;
+            }
+            s.mapped = mapped;
+        }
+        s.top += bytes;
+        return addr;
+    }
+
+    static bool inside(const Segment & s, int64_t addr, int64_t bytes) {
+        return addr >= s.begin && bytes <= s.top - addr;
+    }
+public:
+    explicit GuestMemory(bool ptr32)
+            : mBase(NULL), mSize(ptr32 ? (int64_t)1 << 32 : (int64_t)1 << 36), mPtr32(ptr32),
+              mGlobals(segment(kGuard, kGuard + kGlobals)),
+              mStack(segment(kGuard + kGlobals, kGuard + kGlobals + kStack)),
+              mHeap(segment(kGuard + kGlobals + kStack, mSize)) {
+        void * base = mmap(NULL, mSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (base == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        mBase = (char *)base;
+    }
+    ~GuestMemory() {
+        munmap(mBase, mSize);
+    }
+    GuestMemory(const GuestMemory &) = delete;
+    GuestMemory & operator=(const GuestMemory &) = delete;
+
+    bool ptr32() const {
+        return mPtr32;
+    }
+
+    /// Bytes a value of type takes in guest memory, 8 for the types that have no narrower size
+    int64_t width(const clang::Type * type) const {
+        return width(type, mPtr32);
+    }
+    static int64_t width(const clang::Type * type, bool ptr32) {
+        if (type->isPointerType()) {
+            return ptr32 ? 4 : 8;
+        }
+        if (const clang::BuiltinType * builtin = type->getAs<clang::BuiltinType>()) {
+            switch (builtin->getKind()) {
+                case clang::BuiltinType::Bool:
+                case clang::BuiltinType::Char_U:
+                case clang::BuiltinType::UChar:
+                case clang::BuiltinType::Char_S:
+                case clang::BuiltinType::SChar:
+                    return 1;
+                case clang::BuiltinType::UShort:
+                case clang::BuiltinType::Short:
+                    return 2;
+                case clang::BuiltinType::UInt:
+                case clang::BuiltinType::Int:
+                    return 4;
+                default:
+                    break;
+            }
+        }
+        return 8;
+    }
+
+    /// Host address of [addr, addr + bytes), NULL unless it lies inside one allocated segment
+    char * at(int64_t addr, int64_t bytes) {
+        if (inside(mHeap, addr, bytes) || inside(mStack, addr, bytes) || inside(mGlobals, addr, bytes)) {
+            return mBase + addr;
+        }
+        return NULL;
+    }
+
+    /// Load a value of width bytes, sign extended if sign is set and zero extended otherwise.
+    /// Return false if addr is out of bounds
+    bool load(int64_t addr, int64_t width, bool sign, int64_t & value) {
+        const char * p = at(addr, width);
+        if (!p) {
+            return false;
+        }
+        uint64_t raw = 0;
+        memcpy(&raw, p, width);
+        if (width < 8) {
+            int shift = 64 - 8 * width;
+            value = sign ? (int64_t)(raw << shift) >> shift : (int64_t)raw;
+        }
+        else {
+            value = (int64_t)raw;
+        }
+        return true;
+    }
+
+    /// Store the low width bytes of value, return false if addr is out of bounds
+    bool store(int64_t addr, int64_t width, int64_t value) {
+        char * p = at(addr, width);
+        if (!p) {
+            return false;
+        }
+        memcpy(p, &value, width);
+        return true;
+    }
+
+    /// Zeroed storage on the stack, 0 on overflow; it lives until popStack releases it
+    int64_t pushStack(int64_t bytes) {
+        int64_t addr = grow(mStack, bytes);
+        if (addr) {
+            memset(mBase + addr, 0, mStack.top - addr);
+        }
+        return addr;
+    }
+    int64_t stackTop() const {
+        return mStack.top;
+    }
+    /// Release everything pushed since stackTop() returned mark
+    void popStack(int64_t mark) {
+        mStack.top = mark;
+    }
+
+    /// Fresh, uninitialized heap storage, 0 if the heap is full
+    int64_t growHeap(int64_t bytes) {
+        return grow(mHeap, bytes);
+    }
+    /// Grow the heap up to end, to put blocks back at the addresses they had
+    bool extendHeapTo(int64_t end) {
+        return end <= mHeap.top || grow(mHeap, end - mHeap.top) != 0;
+    }
+
+    /// Guest address of the first global
+    int64_t globalsBegin() const {
+        return mGlobals.begin;
+    }
+    /// The globals segment as laid out so far
+    std::string globals() const {
+        return std::string(mBase + mGlobals.begin, mGlobals.top - mGlobals.begin);
+    }
+    /// Lay out the globals segment with one copy of bytes, a data segment image or what globals() returned.
+    /// The simt engine asks for one copy per lane, back to back
+    bool loadGlobals(const std::string & bytes, unsigned copies = 1) {
+        mGlobals.top = mGlobals.begin;
+        int64_t size = (int64_t)bytes.size() * copies;
+        if (size && grow(mGlobals, size) == 0) {
+            return false;
+        }
+        for (unsigned k = 0; k < copies; k++) {
+            memcpy(mBase + mGlobals.begin + k * (int64_t)bytes.size(), bytes.data(), bytes.size());
+        }
+        return true;
+    }
+};
+
+#endif //ASSIGN1_GUESTMEMORY_H
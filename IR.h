@@ -0,0 +1,285 @@
+//
+// Created by Critizero on 2021/10/22.
+//
+
+#ifndef ASSIGN1_IR_H
+#define ASSIGN1_IR_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "llvm/Support/raw_ostream.h"
+
+/// Operations of the mid-level IR. Operands are virtual registers unless noted :
+///   Const      dst = imm
+///   Copy       dst = a
+///   Add..Eq    dst = a op b, Div stops the program when b is 0
+///   Neg        dst = -a
+///   Global     dst = address of the globals segment + imm
+///   Local      dst = address of the frame's local arrays + imm
+///   Zero       clear imm bytes at address a
+///   Load       dst = imm bytes at address a, zero extended (LoadS : sign extended)
+///   Store      store the low imm bytes of b at address a
+///   Call       dst = function imm of the module, with the b registers args[a], args[a + 1], ...
+///   Get        dst = GET()
+///   Print      PRINT(a)
+///   Malloc     dst = MALLOC(a)
+///   Free       FREE(a)
+///   Br         go to block imm
+///   CondBr     go to block imm if a is not 0, to block b otherwise
+///   Ret        return a
+/// Br, CondBr and Ret end a block and appear nowhere else. Once the function is linked, the
+/// targets of branches in its code are instruction indices instead of blocks.
+enum IROp : uint8_t {
+    IR_Const,
+    IR_Copy,
+    IR_Add,
+    IR_Sub,
+    IR_Mul,
+    IR_Div,
+    IR_Lt,
+    IR_Gt,
+    IR_Eq,
+    IR_Neg,
+    IR_Global,
+    IR_Local,
+    IR_Zero,
+    IR_Load,
+    IR_LoadS,
+    IR_Store,
+    IR_Call,
+    IR_Get,
+    IR_Print,
+    IR_Malloc,
+    IR_Free,
+    IR_Br,
+    IR_CondBr,
+    IR_Ret,
+    IR_NumOps
+};
+
+struct IRInst {
+    int32_t dst;
+    int32_t a;
+    int32_t b;
+    IROp op;
+    int64_t imm;
+
+    static IRInst make(IROp op, int32_t dst, int32_t a = -1, int32_t b = -1, int64_t imm = 0) {
+        IRInst inst;
+        inst.dst = dst;
+        inst.a = a;
+        inst.b = b;
+        inst.op = op;
+        inst.imm = imm;
+        return inst;
+    }
+
+    static const char * name(IROp op) {
+        static const char * names[IR_NumOps] = {
+                "const", "copy", "add", "sub", "mul", "div", "lt", "gt", "eq", "neg", "global", "local",
+                "zero", "load", "loads", "store", "call", "get", "print", "malloc", "free", "br", "condbr", "ret"
+        };
+        return names[op];
+    }
+
+    bool isTerminator() const {
+        return op == IR_Br || op == IR_CondBr || op == IR_Ret;
+    }
+    static bool isBinary(IROp op) {
+        return op >= IR_Add && op <= IR_Eq;
+    }
+    /// Removing it changes nothing but its dst. Div is not, it may stop the program,
+    /// and neither are loads, which may touch an invalid address
+    bool isPure() const {
+        return op == IR_Const || op == IR_Copy || op == IR_Neg || op == IR_Global || op == IR_Local ||
+               (isBinary(op) && op != IR_Div);
+    }
+};
+
+struct IRBlock {
+    std::vector<IRInst> insts;
+
+    const IRInst & terminator() const {
+        return insts.back();
+    }
+    IRInst & terminator() {
+        return insts.back();
+    }
+    /// Blocks the terminator may go to, in a and b (-1 if there is none)
+    void successors(int32_t & a, int32_t & b) const {
+        const IRInst & term = terminator();
+        a = term.op == IR_Ret ? -1 : (int32_t)term.imm;
+        b = term.op == IR_CondBr ? term.b : -1;
+    }
+};
+
+/// One guest function. The parameters arrive in registers 0 .. params - 1 and the entry is blocks[0]
+struct IRFunction {
+    std::string name;
+    unsigned params;
+    unsigned regs;
+    /// Bytes of the local arrays, pushed on the guest stack for each call
+    int64_t frameBytes;
+    std::vector<IRBlock> blocks;
+    /// Argument registers of the calls
+    std::vector<int32_t> args;
+    /// The blocks laid out one after the other by link, what the interpreter runs
+    std::vector<IRInst> code;
+
+    IRFunction() : name(), params(0), regs(0), frameBytes(0), blocks(), args(), code() {
+    }
+
+    int32_t newReg() {
+        return regs++;
+    }
+
+    size_t size() const {
+        size_t count = 0;
+        for (const IRBlock & block : blocks) {
+            count += block.insts.size();
+        }
+        return count;
+    }
+
+    /// Call f on a reference to every register inst reads
+    template <typename F>
+    void forEachUse(IRInst & inst, F f) {
+        switch (inst.op) {
+            case IR_Copy:
+            case IR_Neg:
+            case IR_Zero:
+            case IR_Load:
+            case IR_LoadS:
+            case IR_Print:
+            case IR_Malloc:
+            case IR_Free:
+            case IR_CondBr:
+            case IR_Ret:
+                f(inst.a);
+                break;
+            case IR_Store:
+                f(inst.a);
+                f(inst.b);
+                break;
+            case IR_Call:
+                for (int32_t i = 0; i < inst.b; i++) {
+                    f(args[inst.a + i]);
+                }
+                break;
+            default:
+                if (IRInst::isBinary(inst.op)) {
+                    f(inst.a);
+                    f(inst.b);
+                }
+                break;
+        }
+    }
+
+    /// Lay the blocks out into code, with branch targets turned into instruction indices
+    void link() {
+        std::vector<int64_t> start(blocks.size());
+        code.clear();
+        for (size_t i = 0; i < blocks.size(); i++) {
+            start[i] = code.size();
+            code.insert(code.end(), blocks[i].insts.begin(), blocks[i].insts.end());
+        }
+        for (IRInst & inst : code) {
+            if (inst.op == IR_Br || inst.op == IR_CondBr) {
+                inst.imm = start[inst.imm];
+            }
+            if (inst.op == IR_CondBr) {
+                inst.b = start[inst.b];
+            }
+        }
+    }
+
+    void print(llvm::raw_ostream & os) const {
+        os << "func " << name << " : " << params << " params, " << regs << " regs, "
+           << frameBytes << " bytes of arrays\n";
+        for (size_t i = 0; i < blocks.size(); i++) {
+            os << "bb" << i << ":\n";
+            for (const IRInst & inst : blocks[i].insts) {
+                os << "  ";
+                if (inst.dst >= 0) {
+                    os << "r" << inst.dst << " = ";
+                }
+                os << IRInst::name(inst.op);
+                switch (inst.op) {
+                    case IR_Const:
+                    case IR_Global:
+                    case IR_Local:
+                        os << " " << inst.imm;
+                        break;
+                    case IR_Br:
+                        os << " bb" << inst.imm;
+                        break;
+                    case IR_CondBr:
+                        os << " r" << inst.a << ", bb" << inst.imm << ", bb" << inst.b;
+                        break;
+                    case IR_Zero:
+                    case IR_Load:
+                    case IR_LoadS:
+                        os << inst.imm << " r" << inst.a;
+                        break;
+                    case IR_Store:
+                        os << inst.imm << " r" << inst.a << ", r" << inst.b;
+                        break;
+                    case IR_Call:
+                        os << " " << inst.imm << "(";
+                        for (int32_t k = 0; k < inst.b; k++) {
+                            os << (k ? ", r" : "r") << args[inst.a + k];
+                        }
+                        os << ")";
+                        break;
+                    case IR_Get:
+                        break;
+                    default:
+                        os << " r" << inst.a;
+                        if (IRInst::isBinary(inst.op)) {
+                            os << ", r" << inst.b;
+                        }
+                        break;
+                }
+                os << "\n";
+            }
+        }
+    }
+};
+
+/// A lowered program : its functions, the initial globals segment and the function that
+/// evaluates the global initializers that are not constants
+struct IRModule {
+    std::vector<IRFunction> functions;
+    int32_t entry;
+    /// -1 if every global initializer is constant
+    int32_t init;
+    std::string data;
+
+    IRModule() : functions(), entry(-1), init(-1), data() {
+    }
+
+    size_t size() const {
+        size_t count = 0;
+        for (const IRFunction & func : functions) {
+            count += func.size();
+        }
+        return count;
+    }
+
+    void link() {
+        for (IRFunction & func : functions) {
+            func.link();
+        }
+    }
+
+    void print(llvm::raw_ostream & os) const {
+        for (size_t i = 0; i < functions.size(); i++) {
+            os << i << " ";
+            functions[i].print(os);
+        }
+    }
+};
+
+#endif //ASSIGN1_IR_H
@@ -0,0 +1,290 @@
+//
+// Created by Critizero on 2021/10/22.
+//
+
+#ifndef ASSIGN1_IRINTERPRETER_H
+#define ASSIGN1_IRINTERPRETER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "llvm/Support/raw_ostream.h"
+
+#include "Environment.h"
+#include "GuestIO.h"
+#include "GuestMemory.h"
+#include "IR.h"
+#include "IRSuperinsts.h"
+#include "OpProfile.h"
+#include "Options.h"
+
+/// Rewrite the first instruction of each sequence of the linked code that a superinstruction
+/// runs into that superinstruction, trying the longest first. The rest of the sequence stays as
+/// it was : the handler reads its operands from there, and a branch into the middle of the
+/// sequence still finds plain instructions. Return the number of sequences fused
+static inline size_t fuseSuperinsts(IRModule & module) {
+    size_t fused = 0;
+    for (IRFunction & func : module.functions) {
+        std::vector<IRInst> & code = func.code;
+        for (size_t i = 0; i < code.size(); i++) {
+            const IRSuperinst * best = NULL;
+            for (const IRSuperinst & super : kIRSuperinsts) {
+                if (i + super.length > code.size() || (best && best->length >= super.length)) {
+                    continue;
+                }
+                bool match = true;
+                for (unsigned k = 0; k < super.length; k++) {
+                    match = match && code[i + k].op == super.ops[k];
+                }
+                if (match) {
+                    best = &super;
+                }
+            }
+            if (best) {
+                code[i].op = (IROp)best->op;
+                fused++;
+            }
+        }
+    }
+    return fused;
+}
+
+/// Runs the linked code of an IRModule. The registers of all active calls are one array, each
+/// call using the window after its caller's; guest memory, the heap and GET / PRINT work as in
+/// the Environment. The module is only read, so many interpreters can run it on different threads
+class IRInterpreter {
+    const IRModule & mModule;
+    GuestMemory mMemory;
+    Heap mHeap;
+    /// Registers of the active calls
+    std::vector<int64_t> mRegs;
+    /// Start of the first free register window
+    size_t mRegTop;
+    /// Output of PRINT
+    OutputBuffer mOut;
+    /// Input of GET in batch mode, GET prompts and reads stdin otherwise
+    InputReader mIn;
+    std::string mInputPath;
+    /// PRINT output is captured and GET never prompts
+    bool mCaptured;
+    /// Opcode sequences that ran, with --op-profile
+    std::unique_ptr<OpProfile> mProfile;
+    std::string mProfilePath;
+
+    /// Report a runtime error of the guest program and stop it
+    void fatal(const char * msg) {
+        mOut.flush();
+        throw InterpreterError(msg);
+    }
+
+    /// Make room for regs registers after the first free window, return false if mRegs moved
+    bool reserve(size_t regs) {
+        if (mRegTop + regs <= mRegs.size()) {
+            return true;
+        }
+        mRegs.resize(std::max(mRegTop + regs, mRegs.size() * 2));
+        return false;
+    }
+
+    /// Run function index, its arguments already in the first registers of the free window.
+    /// With kProfile, also count the opcode sequences that run next to each other in the code
+    template <bool kProfile>
+    int64_t execute(int32_t index) {
+        const IRFunction & func = mModule.functions[index];
+        size_t base = mRegTop;
+        reserve(func.regs);
+        mRegTop += func.regs;
+        int64_t * r = mRegs.data() + base;
+        int64_t mark = mMemory.stackTop();
+        int64_t frame = 0;
+        if (func.frameBytes) {
+            frame = mMemory.pushStack(func.frameBytes);
+            if (!frame) {
+                fatal("[ERROR] Guest Stack Overflow");
+            }
+        }
+        const IRInst * code = func.code.data();
+        const IRInst * pc = code;
+        /// With kProfile, where the next instruction in the code is and the ops of the last two
+        /// instructions, IR_NumOps when they did not run in a row
+        const IRInst * next = NULL;
+        IROp ops[2] = { IR_NumOps, IR_NumOps };
+        for (;;) {
+            const IRInst & inst = *pc++;
+            if (kProfile) {
+                if (&inst != next) {
+                    ops[0] = ops[1] = IR_NumOps;
+                }
+                mProfile->record(ops[0], ops[1], inst.op);
+                ops[0] = ops[1];
+                ops[1] = inst.op;
+                next = pc;
+            }
+            /// Not switching on the IROp : the superinstructions are numbered after it
+            switch ((uint8_t)inst.op) {
+                case IR_Const:
+                    r[inst.dst] = inst.imm;
+                    break;
+                case IR_Copy:
+                    r[inst.dst] = r[inst.a];
+                    break;
+                case IR_Add:
+                    r[inst.dst] = r[inst.a] + r[inst.b];
+                    break;
+                case IR_Sub:
+                    r[inst.dst] = r[inst.a] - r[inst.b];
+                    break;
+                case IR_Mul:
+                    r[inst.dst] = r[inst.a] * r[inst.b];
+                    break;
+                case IR_Div:
+                    if (r[inst.b] == 0) {
+                        fatal("[ERROR] Dived By Zero");
+                    }
+                    r[inst.dst] = r[inst.a] / r[inst.b];
+                    break;
+                case IR_Lt:
+                    r[inst.dst] = r[inst.a] < r[inst.b];
+                    break;
+                case IR_Gt:
+                    r[inst.dst] = r[inst.a] > r[inst.b];
+                    break;
+                case IR_Eq:
+                    r[inst.dst] = r[inst.a] == r[inst.b];
+                    break;
+                case IR_Neg:
+                    r[inst.dst] = -r[inst.a];
+                    break;
+                case IR_Global:
+                    r[inst.dst] = mMemory.globalsBegin() + inst.imm;
+                    break;
+                case IR_Local:
+                    r[inst.dst] = frame + inst.imm;
+                    break;
+                case IR_Zero: {
+                    char * p = mMemory.at(r[inst.a], inst.imm);
+                    if (!p) {
+                        fatal("[ERROR] Invalid Memory Access");
+                    }
+                    memset(p, 0, inst.imm);
+                    break;
+                }
+                case IR_Load:
+                case IR_LoadS:
+                    if (!mMemory.load(r[inst.a], inst.imm, inst.op == IR_LoadS, r[inst.dst])) {
+                        fatal("[ERROR] Invalid Memory Access");
+                    }
+                    break;
+                case IR_Store:
+                    if (!mMemory.store(r[inst.a], inst.imm, r[inst.b])) {
+                        fatal("[ERROR] Invalid Memory Access");
+                    }
+                    break;
+                case IR_Call: {
+                    const IRFunction & callee = mModule.functions[inst.imm];
+                    if (!reserve(callee.regs)) {
+                        r = mRegs.data() + base;
+                    }
+                    int64_t * params = mRegs.data() + mRegTop;
+                    for (int32_t k = 0; k < inst.b && k < (int32_t)callee.params; k++) {
+                        params[k] = r[func.args[inst.a + k]];
+                    }
+                    int64_t ret = execute<kProfile>(inst.imm);
+                    /// The callee may have grown the registers
+                    r = mRegs.data() + base;
+                    r[inst.dst] = ret;
+                    break;
+                }
+                case IR_Get: {
+                    int64_t val = 0;
+                    if (mIn.isOpen()) {
+                        mIn.readInt(val);
+                    }
+                    else {
+                        /// The prompt has to come after everything printed before it
+                        mOut.flush();
+                        llvm::errs() << "Please Input an Integer Value : ";
+                        scanf("%ld", &val);
+                    }
+                    r[inst.dst] = val;
+                    break;
+                }
+                case IR_Print:
+                    mOut.writeInt(r[inst.a]);
+                    break;
+                case IR_Malloc:
+                    r[inst.dst] = mHeap.Malloc(r[inst.a]);
+                    if (!r[inst.dst]) {
+                        fatal("[ERROR] Out Of Guest Memory");
+                    }
+                    break;
+                case IR_Free:
+                    if (!mHeap.Free(r[inst.a])) {
+                        fatal("[ERROR] Not A Valid Address");
+                    }
+                    break;
+                case IR_Br:
+                    pc = code + inst.imm;
+                    break;
+                case IR_CondBr:
+                    pc = code + (r[inst.a] ? inst.imm : inst.b);
+                    break;
+                case IR_Ret: {
+                    int64_t ret = r[inst.a];
+                    mMemory.popStack(mark);
+                    mRegTop = base;
+                    return ret;
+                }
+#include "IRSuperinstCases.inc"
+                default:
+                    fatal("[ERROR] Unknown Instruction");
+            }
+        }
+    }
+    int64_t call(int32_t index) {
+        return mProfile ? execute<true>(index) : execute<false>(index);
+    }
+public:
+    /// With capture, PRINT appends to *capture and GET reads input (nothing if it is empty)
+    /// instead of prompting, as one program of a batch
+    IRInterpreter(const IRModule & module, const InterpreterOptions & options, std::string * capture = NULL,
+                  const std::string & input = std::string())
+            : mModule(module), mMemory(options.ptr32), mHeap(mMemory), mRegs(), mRegTop(0),
+              mOut(options.printTo == "stdout" ? STDOUT_FILENO : STDERR_FILENO, capture),
+              mIn(), mInputPath(capture ? input : options.input), mCaptured(capture != NULL),
+              mProfile(options.opProfile.empty() ? NULL : new OpProfile()), mProfilePath(options.opProfile) {
+    }
+
+    /// Open the input, lay out the globals and run the initializers that are not constants
+    void init() {
+        if (!mInputPath.empty()) {
+            if (!mIn.open(mInputPath)) {
+                fatal("[ERROR] Cannot Read Input");
+            }
+        }
+        else if (mCaptured) {
+            mIn.openEmpty();
+        }
+        if (!mMemory.loadGlobals(mModule.data)) {
+            fatal("[ERROR] Out Of Guest Memory");
+        }
+        if (mModule.init >= 0) {
+            call(mModule.init);
+        }
+    }
+
+    void run() {
+        call(mModule.entry);
+        mOut.flush();
+        if (mProfile && !mProfile->write(mProfilePath)) {
+            fatal("[ERROR] Cannot Write Op Profile");
+        }
+    }
+};
+
+#endif //ASSIGN1_IRINTERPRETER_H
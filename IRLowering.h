@@ -0,0 +1,458 @@
+//
+// Created by Critizero on 2021/10/22.
+//
+
+#ifndef ASSIGN1_IRLOWERING_H
+#define ASSIGN1_IRLOWERING_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "clang/AST/Decl.h"
+#include "clang/AST/Expr.h"
+#include "clang/AST/Stmt.h"
+#include "llvm/ADT/DenseMap.h"
+
+#include "Environment.h"
+#include "GuestMemory.h"
+#include "IR.h"
+#include "ProgramInfo.h"
+
+using namespace clang;
+
+/// Lowering of the AST subset the engines run into the IR.
+/// Scalar locals and parameters live in virtual registers; globals, arrays and whatever a pointer
+/// reaches are in guest memory and go through explicit loads and stores of the width of their
+/// C type. Local arrays get a fixed place in the frame's part of the guest stack and are cleared
+/// where they are declared, like the Environment does.
+/// Like the SIMT engine, and unlike the scalar Environment, calls are evaluated wherever they
+/// appear and the init statement of a for loop runs.
+/// Constructs the IR has no lowering for throw an InterpreterError.
+class IRLowering {
+    const ProgramInfo & mInfo;
+    IRModule & mModule;
+    bool mPtr32;
+    /// Index in the module of each defined function
+    llvm::DenseMap<const FunctionDecl *, int32_t> mFunctions;
+
+    IRFunction * mFunc;
+    int32_t mBlock;
+    /// Register of each parameter and local of the function, for an array the one holding its address
+    llvm::DenseMap<const Decl *, int32_t> mVars;
+    /// Registers that hold a variable, the others are temporaries read once
+    std::vector<char> mIsVar;
+
+    /// Bytes of an object of type in guest memory
+    int64_t size(const Type * type) const {
+        if (auto array = dyn_cast<ConstantArrayType>(type)) {
+            return array->getSize().getSExtValue() * size(array->getElementType().getTypePtr());
+        }
+        return GuestMemory::width(type, mPtr32);
+    }
+
+    int32_t newBlock() {
+        mFunc->blocks.push_back(IRBlock());
+        return mFunc->blocks.size() - 1;
+    }
+    void emit(const IRInst & inst) {
+        mFunc->blocks[mBlock].insts.push_back(inst);
+    }
+    /// Emit op into a new temporary and return it
+    int32_t def(IROp op, int32_t a = -1, int32_t b = -1, int64_t imm = 0) {
+        int32_t dst = mFunc->newReg();
+        emit(IRInst::make(op, dst, a, b, imm));
+        return dst;
+    }
+    /// End the current block with a jump and continue in next
+    void jump(int32_t target, int32_t next) {
+        emit(IRInst::make(IR_Br, -1, -1, -1, target));
+        mBlock = next;
+    }
+    void branch(int32_t cond, int32_t then_block, int32_t else_block) {
+        emit(IRInst::make(IR_CondBr, -1, cond, else_block, then_block));
+        mBlock = then_block;
+    }
+
+    int32_t newVar(const Decl * decl) {
+        int32_t reg = mFunc->newReg();
+        mVars[decl] = reg;
+        mIsVar.resize(mFunc->regs, 0);
+        mIsVar[reg] = 1;
+        return reg;
+    }
+    bool isVar(int32_t reg) const {
+        return reg < (int32_t)mIsVar.size() && mIsVar[reg];
+    }
+
+    /// var = value. A temporary that was just computed is computed into var instead of copied
+    void setVar(int32_t var, int32_t value) {
+        if (value == var) {
+            return;
+        }
+        std::vector<IRInst> & insts = mFunc->blocks[mBlock].insts;
+        if (!isVar(value) && !insts.empty() && insts.back().dst == value) {
+            insts.back().dst = var;
+            return;
+        }
+        emit(IRInst::make(IR_Copy, var, value));
+    }
+
+    int32_t load(int32_t addr, const Type * type) {
+        return def(type->isSignedIntegerType() ? IR_LoadS : IR_Load, addr, -1, GuestMemory::width(type, mPtr32));
+    }
+    void store(int32_t addr, const Type * type, int32_t value) {
+        emit(IRInst::make(IR_Store, -1, addr, value, GuestMemory::width(type, mPtr32)));
+    }
+
+    /// Address of the global decl, -1 if it is not one
+    int32_t globalAddr(const Decl * decl) {
+        int64_t offset = mInfo.getData().offset(decl);
+        return offset < 0 ? -1 : def(IR_Global, -1, -1, offset);
+    }
+
+    /// Value of a variable, an array evaluates to its address
+    int32_t readVar(DeclRefExpr * ref) {
+        auto it = mVars.find(ref->getDecl());
+        if (it != mVars.end()) {
+            return it->second;
+        }
+        int32_t addr = globalAddr(ref->getDecl());
+        if (addr < 0) {
+            throw InterpreterError("[ERROR] Unknown Expr");
+        }
+        const Type * type = ref->getType().getTypePtr();
+        return isa<ConstantArrayType>(type) ? addr : load(addr, type);
+    }
+
+    int32_t elementAddr(ArraySubscriptExpr * array) {
+        int32_t base = value(array->getBase());
+        int32_t idx = value(array->getIdx());
+        int64_t stride = size(array->getType().getTypePtr());
+        if (stride != 1) {
+            idx = def(IR_Mul, idx, def(IR_Const, -1, -1, stride));
+        }
+        return def(IR_Add, base, idx);
+    }
+
+    int32_t assign(BinaryOperator * bop) {
+        Expr * left = bop->getLHS()->IgnoreParens();
+        int32_t val = value(bop->getRHS());
+        int32_t addr;
+        if (DeclRefExpr * declexpr = dyn_cast<DeclRefExpr>(left)) {
+            auto it = mVars.find(declexpr->getDecl());
+            if (it != mVars.end()) {
+                setVar(it->second, val);
+                return it->second;
+            }
+            addr = globalAddr(declexpr->getDecl());
+            if (addr < 0) {
+                throw InterpreterError("[ERROR] Unknown Expr");
+            }
+        }
+        else if (auto array = dyn_cast<ArraySubscriptExpr>(left)) {
+            addr = elementAddr(array);
+        }
+        else if (auto uop = dyn_cast<UnaryOperator>(left)) {
+            if (uop->getOpcode() != UO_Deref) {
+                throw InterpreterError("[ERROR] Unknown Operator");
+            }
+            addr = value(uop->getSubExpr());
+        }
+        else {
+            throw InterpreterError("[ERROR] Unknown Expr");
+        }
+        store(addr, left->getType().getTypePtr(), val);
+        return val;
+    }
+
+    int32_t binop(BinaryOperator * bop) {
+        if (bop->getOpcode() == BO_Assign) {
+            return assign(bop);
+        }
+        Expr * left = bop->getLHS();
+        int32_t l = value(left);
+        int32_t r = value(bop->getRHS());
+        switch (bop->getOpcode()) {
+            case BO_Add:
+            case BO_Sub:
+                /// Pointer arithmetic counts in elements
+                if (left->getType().getTypePtr()->isPointerType()) {
+                    int64_t scale = GuestMemory::width(left->getType()->getPointeeType().getTypePtr(), mPtr32);
+                    if (scale != 1) {
+                        r = def(IR_Mul, r, def(IR_Const, -1, -1, scale));
+                    }
+                }
+                return def(bop->getOpcode() == BO_Add ? IR_Add : IR_Sub, l, r);
+            case BO_Mul:
+                return def(IR_Mul, l, r);
+            case BO_Div:
+                return def(IR_Div, l, r);
+            case BO_LT:
+                return def(IR_Lt, l, r);
+            case BO_GT:
+                return def(IR_Gt, l, r);
+            case BO_EQ:
+                return def(IR_Eq, l, r);
+            default:
+                throw InterpreterError("[ERROR] Unknown Operator");
+        }
+    }
+
+    int32_t unaryop(UnaryOperator * uop) {
+        int32_t val = value(uop->getSubExpr());
+        switch (uop->getOpcode()) {
+            case UO_Minus:
+                return def(IR_Neg, val);
+            case UO_Plus:
+                return val;
+            case UO_Deref:
+                return load(val, uop->getType().getTypePtr());
+            default:
+                throw InterpreterError("[ERROR] Unknown Operator");
+        }
+    }
+
+    int32_t call(CallExpr * call_expr) {
+        FunctionDecl * callee = call_expr->getDirectCallee();
+        if (!callee) {
+            throw InterpreterError("[ERROR] Unknown Expr");
+        }
+        if (callee == mInfo.getInput()) {
+            return def(IR_Get);
+        }
+        if (callee == mInfo.getOutput()) {
+            int32_t val = value(call_expr->getArg(0));
+            emit(IRInst::make(IR_Print, -1, val));
+            return val;
+        }
+        if (callee == mInfo.getMalloc()) {
+            return def(IR_Malloc, value(call_expr->getArg(0)));
+        }
+        if (callee == mInfo.getFree()) {
+            int32_t addr = value(call_expr->getArg(0));
+            emit(IRInst::make(IR_Free, -1, addr));
+            return addr;
+        }
+        const FunctionDecl * definition = NULL;
+        if (!callee->getBody(definition)) {
+            throw InterpreterError("[ERROR] Unknown Function");
+        }
+        std::vector<int32_t> args;
+        for (auto b = call_expr->arg_begin(), e = call_expr->arg_end(); b != e; b++) {
+            args.push_back(value(*b));
+        }
+        int32_t first = mFunc->args.size();
+        mFunc->args.insert(mFunc->args.end(), args.begin(), args.end());
+        return def(IR_Call, first, args.size(), mFunctions[definition]);
+    }
+
+    /// Register holding the value of expr
+    int32_t value(Expr * expr) {
+        expr = expr->IgnoreImpCasts();
+        if (auto exp = dyn_cast<ParenExpr>(expr)) {
+            return value(exp->getSubExpr());
+        }
+        if (auto exp = dyn_cast<CStyleCastExpr>(expr)) {
+            return value(exp->getSubExpr());
+        }
+        if (auto exp = dyn_cast<IntegerLiteral>(expr)) {
+            return def(IR_Const, -1, -1, exp->getValue().getSExtValue());
+        }
+        if (auto exp = dyn_cast<CharacterLiteral>(expr)) {
+            return def(IR_Const, -1, -1, exp->getValue());
+        }
+        if (auto exp = dyn_cast<DeclRefExpr>(expr)) {
+            return readVar(exp);
+        }
+        if (auto exp = dyn_cast<BinaryOperator>(expr)) {
+            return binop(exp);
+        }
+        if (auto exp = dyn_cast<UnaryOperator>(expr)) {
+            return unaryop(exp);
+        }
+        if (auto exp = dyn_cast<ArraySubscriptExpr>(expr)) {
+            /// An element that is itself an array evaluates to its address
+            int32_t addr = elementAddr(exp);
+            const Type * type = exp->getType().getTypePtr();
+            return isa<ConstantArrayType>(type) ? addr : load(addr, type);
+        }
+        if (auto exp = dyn_cast<CallExpr>(expr)) {
+            return call(exp);
+        }
+        if (auto exp = dyn_cast<UnaryExprOrTypeTraitExpr>(expr)) {
+            int64_t size = 0;
+            if (exp->getKind() == UETT_SizeOf) {
+                if (exp->getArgumentType()->isIntegerType() || exp->getArgumentType()->isPointerType()) {
+                    size = GuestMemory::width(exp->getArgumentType().getTypePtr(), mPtr32);
+                }
+            }
+            return def(IR_Const, -1, -1, size);
+        }
+        throw InterpreterError("[ERROR] Unknown Expr");
+    }
+
+    void declare(DeclStmt * decl_stmt) {
+        for (DeclStmt::decl_iterator it = decl_stmt->decl_begin(), ie = decl_stmt->decl_end(); it != ie; ++ it) {
+            VarDecl * var_decl = dyn_cast<VarDecl>(*it);
+            if (!var_decl) {
+                continue;
+            }
+            const Type * type = var_decl->getType().getTypePtr();
+            if (isa<ConstantArrayType>(type)) {
+                int64_t bytes = size(type);
+                int32_t reg = newVar(var_decl);
+                emit(IRInst::make(IR_Local, reg, -1, -1, mFunc->frameBytes));
+                emit(IRInst::make(IR_Zero, -1, reg, -1, bytes));
+                mFunc->frameBytes += (bytes + 7) & ~(int64_t)7;
+            }
+            else if (var_decl->hasInit()) {
+                int32_t val = value(var_decl->getInit());
+                setVar(newVar(var_decl), val);
+            }
+            else {
+                emit(IRInst::make(IR_Const, newVar(var_decl), -1, -1, 0));
+            }
+        }
+    }
+
+    void stmt(Stmt * stmt) {
+        if (auto compound = dyn_cast<CompoundStmt>(stmt)) {
+            for (Stmt * child : compound->body()) {
+                this->stmt(child);
+            }
+        }
+        else if (auto decl_stmt = dyn_cast<DeclStmt>(stmt)) {
+            declare(decl_stmt);
+        }
+        else if (auto if_stmt = dyn_cast<IfStmt>(stmt)) {
+            int32_t cond = value(if_stmt->getCond());
+            int32_t then_block = newBlock();
+            int32_t else_block = if_stmt->getElse() ? newBlock() : -1;
+            int32_t join = newBlock();
+            branch(cond, then_block, else_block >= 0 ? else_block : join);
+            this->stmt(if_stmt->getThen());
+            if (else_block >= 0) {
+                jump(join, else_block);
+                this->stmt(if_stmt->getElse());
+            }
+            jump(join, join);
+        }
+        else if (auto while_stmt = dyn_cast<WhileStmt>(stmt)) {
+            int32_t header = newBlock();
+            jump(header, header);
+            int32_t cond = value(while_stmt->getCond());
+            int32_t body = newBlock();
+            int32_t exit = newBlock();
+            branch(cond, body, exit);
+            this->stmt(while_stmt->getBody());
+            jump(header, exit);
+        }
+        else if (auto for_stmt = dyn_cast<ForStmt>(stmt)) {
+            if (Stmt * init = for_stmt->getInit()) {
+                this->stmt(init);
+            }
+            int32_t header = newBlock();
+            jump(header, header);
+            int32_t body = newBlock();
+            int32_t inc = newBlock();
+            int32_t exit = newBlock();
+            if (Expr * cond = for_stmt->getCond()) {
+                branch(value(cond), body, exit);
+            }
+            else {
+                jump(body, body);
+            }
+            this->stmt(for_stmt->getBody());
+            jump(inc, inc);
+            if (Expr * inc_expr = for_stmt->getInc()) {
+                value(inc_expr);
+            }
+            jump(header, exit);
+        }
+        else if (auto return_stmt = dyn_cast<ReturnStmt>(stmt)) {
+            Expr * ret = return_stmt->getRetValue();
+            int32_t val = ret ? value(ret) : def(IR_Const, -1, -1, 0);
+            emit(IRInst::make(IR_Ret, -1, val));
+            /// Whatever follows the return goes to a block nothing jumps to
+            mBlock = newBlock();
+        }
+        else if (isa<NullStmt>(stmt)) {
+        }
+        else if (Expr * expr = dyn_cast<Expr>(stmt)) {
+            value(expr);
+        }
+        else {
+            throw InterpreterError("[ERROR] Unknown Stmt");
+        }
+    }
+
+    void begin(IRFunction & func, const std::string & name) {
+        mFunc = &func;
+        mVars.clear();
+        mIsVar.clear();
+        func.name = name;
+        mBlock = newBlock();
+    }
+    /// Falling off the end of a function returns 0
+    void end() {
+        emit(IRInst::make(IR_Ret, -1, def(IR_Const, -1, -1, 0)));
+    }
+
+    void function(const FunctionDecl * decl, IRFunction & func) {
+        begin(func, decl->getNameAsString());
+        for (auto i = decl->param_begin(), j = decl->param_end(); i != j; i++) {
+            newVar(*i);
+        }
+        func.params = decl->getNumParams();
+        stmt(decl->getBody());
+        end();
+    }
+
+    /// The function that stores the values of the global initializers that are not constants
+    void initializers(IRFunction & func) {
+        begin(func, "<init>");
+        for (const DataSegment::DynamicInit & init : mInfo.getData().dynamic()) {
+            int32_t val = value(init.init);
+            store(def(IR_Global, -1, -1, init.offset), init.type, val);
+        }
+        end();
+    }
+public:
+    IRLowering(const ProgramInfo & info, IRModule & module, bool ptr32)
+            : mInfo(info), mModule(module), mPtr32(ptr32), mFunctions(), mFunc(NULL), mBlock(0),
+              mVars(), mIsVar() {
+    }
+
+    /// Lower every function defined in unit into the module
+    void lower(TranslationUnitDecl * unit) {
+        if (!mInfo.getEntry()) {
+            throw InterpreterError("[ERROR] No main In Program");
+        }
+        /// Number the functions first, a call may come before the definition of its callee
+        std::vector<const FunctionDecl *> defined;
+        for (TranslationUnitDecl::decl_iterator i = unit->decls_begin(), e = unit->decls_end(); i != e; ++ i) {
+            FunctionDecl * fdecl = dyn_cast<FunctionDecl>(*i);
+            if (fdecl && fdecl->isThisDeclarationADefinition()) {
+                mFunctions[fdecl] = defined.size();
+                defined.push_back(fdecl);
+            }
+        }
+        mModule.functions.resize(defined.size());
+        for (size_t i = 0; i < defined.size(); i++) {
+            function(defined[i], mModule.functions[i]);
+        }
+        const FunctionDecl * entry = NULL;
+        if (!mInfo.getEntry()->getBody(entry)) {
+            throw InterpreterError("[ERROR] No main In Program");
+        }
+        mModule.entry = mFunctions[entry];
+        mModule.data = mInfo.getData().image();
+        if (!mInfo.getData().dynamic().empty()) {
+            mModule.init = mModule.functions.size();
+            mModule.functions.push_back(IRFunction());
+            initializers(mModule.functions.back());
+        }
+    }
+};
+
+#endif //ASSIGN1_IRLOWERING_H
@@ -0,0 +1,1144 @@
+//
+// Created by Critizero on 2021/10/22.
+//
+
+#ifndef ASSIGN1_IRPASSES_H
+#define ASSIGN1_IRPASSES_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "IR.h"
+
+/// A transformation of one function of the IR
+class IRPass {
+public:
+    virtual ~IRPass() {
+    }
+    virtual const char * name() const = 0;
+    /// Called once before the pass runs over the functions of module
+    virtual void begin(const IRModule & module) {
+    }
+    /// Return true if func changed
+    virtual bool run(IRFunction & func) = 0;
+};
+
+/// Predecessor count of each block, counting a CondBr with both targets the same once per edge
+static inline std::vector<unsigned> predecessorCounts(const IRFunction & func) {
+    std::vector<unsigned> preds(func.blocks.size(), 0);
+    for (const IRBlock & block : func.blocks) {
+        int32_t a, b;
+        block.successors(a, b);
+        if (a >= 0) {
+            preds[a]++;
+        }
+        if (b >= 0) {
+            preds[b]++;
+        }
+    }
+    return preds;
+}
+
+/// Liveness before inst from liveness after it
+static inline void livenessStep(IRFunction & func, IRInst & inst, llvm::BitVector & live) {
+    if (inst.dst >= 0) {
+        live.reset(inst.dst);
+    }
+    func.forEachUse(inst, [&](int32_t & reg) {
+        live.set(reg);
+    });
+}
+
+/// Registers live at the end of block b, from the registers live at the start of each block
+static inline llvm::BitVector liveOut(const IRFunction & func, const std::vector<llvm::BitVector> & in, size_t b) {
+    llvm::BitVector live(func.regs);
+    int32_t succ[2];
+    func.blocks[b].successors(succ[0], succ[1]);
+    for (int32_t s : succ) {
+        if (s >= 0) {
+            live |= in[s];
+        }
+    }
+    return live;
+}
+
+/// Registers live at the start of each block, by backward dataflow until nothing changes
+static inline std::vector<llvm::BitVector> liveIn(IRFunction & func) {
+    size_t blocks = func.blocks.size();
+    std::vector<llvm::BitVector> in(blocks, llvm::BitVector(func.regs));
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t b = blocks; b-- > 0; ) {
+            llvm::BitVector live = liveOut(func, in, b);
+            std::vector<IRInst> & insts = func.blocks[b].insts;
+            for (size_t i = insts.size(); i-- > 0; ) {
+                livenessStep(func, insts[i], live);
+            }
+            if (live != in[b]) {
+                in[b] = live;
+                changed = true;
+            }
+        }
+    }
+    return in;
+}
+
+/// Forward dataflow over the blocks with a three level lattice per register : unknown (nothing
+/// reaches it yet), one constant, or varying. An instruction whose operands are constants is
+/// replaced by its result, a CondBr on a constant by a Br
+class ConstantPropagation : public IRPass {
+    enum Level : uint8_t {
+        Unknown,
+        Constant,
+        Varying
+    };
+    struct Value {
+        Level level;
+        int64_t constant;
+    };
+    typedef std::vector<Value> State;
+
+    static Value varying() {
+        Value v = { Varying, 0 };
+        return v;
+    }
+    static Value constant(int64_t c) {
+        Value v = { Constant, c };
+        return v;
+    }
+
+    /// Meet from into into, return true if into changed
+    static bool meet(State & into, const State & from) {
+        bool changed = false;
+        for (size_t i = 0; i < into.size(); i++) {
+            Value & v = into[i];
+            const Value & w = from[i];
+            if (w.level == Unknown || v.level == Varying) {
+                continue;
+            }
+            if (v.level == Unknown) {
+                v = w;
+                changed = true;
+            }
+            else if (w.level == Varying || w.constant != v.constant) {
+                v = varying();
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    /// Value inst leaves in its dst, given the values of the registers before it
+    static Value evaluate(const IRInst & inst, const State & state) {
+        if (inst.op == IR_Const) {
+            return constant(inst.imm);
+        }
+        if (inst.op == IR_Copy || inst.op == IR_Neg) {
+            const Value & a = state[inst.a];
+            if (a.level != Constant) {
+                return a;
+            }
+            return constant(inst.op == IR_Neg ? -a.constant : a.constant);
+        }
+        if (IRInst::isBinary(inst.op)) {
+            const Value & a = state[inst.a];
+            const Value & b = state[inst.b];
+            if (a.level == Varying || b.level == Varying) {
+                return varying();
+            }
+            if (a.level == Unknown || b.level == Unknown) {
+                Value v = { Unknown, 0 };
+                return v;
+            }
+            switch (inst.op) {
+                case IR_Add:
+                    return constant(a.constant + b.constant);
+                case IR_Sub:
+                    return constant(a.constant - b.constant);
+                case IR_Mul:
+                    return constant(a.constant * b.constant);
+                case IR_Div:
+                    /// Dividing by zero stays, to stop the program when it runs
+                    return b.constant == 0 ? varying() : constant(a.constant / b.constant);
+                case IR_Lt:
+                    return constant(a.constant < b.constant);
+                case IR_Gt:
+                    return constant(a.constant > b.constant);
+                default:
+                    return constant(a.constant == b.constant);
+            }
+        }
+        return varying();
+    }
+
+    static void transfer(const IRBlock & block, State & state) {
+        for (const IRInst & inst : block.insts) {
+            if (inst.dst >= 0) {
+                state[inst.dst] = evaluate(inst, state);
+            }
+        }
+    }
+public:
+    const char * name() const override {
+        return "constprop";
+    }
+
+    bool run(IRFunction & func) override {
+        size_t blocks = func.blocks.size();
+        Value unknown = { Unknown, 0 };
+        std::vector<State> in(blocks, State(func.regs, unknown));
+        std::vector<char> reached(blocks, 0);
+        /// Parameters and anything read before it is written are varying at the entry
+        in[0].assign(func.regs, varying());
+        reached[0] = 1;
+        std::vector<int32_t> worklist(1, 0);
+        std::vector<char> queued(blocks, 0);
+        queued[0] = 1;
+        while (!worklist.empty()) {
+            int32_t b = worklist.back();
+            worklist.pop_back();
+            queued[b] = 0;
+            State out(in[b]);
+            transfer(func.blocks[b], out);
+            int32_t succ[2];
+            func.blocks[b].successors(succ[0], succ[1]);
+            for (int32_t s : succ) {
+                if (s >= 0 && (meet(in[s], out) || !reached[s])) {
+                    reached[s] = 1;
+                    if (!queued[s]) {
+                        queued[s] = 1;
+                        worklist.push_back(s);
+                    }
+                }
+            }
+        }
+
+        bool changed = false;
+        for (size_t b = 0; b < blocks; b++) {
+            if (!reached[b]) {
+                continue;
+            }
+            State & state = in[b];
+            for (IRInst & inst : func.blocks[b].insts) {
+                if (inst.op == IR_CondBr && state[inst.a].level == Constant) {
+                    inst = IRInst::make(IR_Br, -1, -1, -1, state[inst.a].constant ? inst.imm : inst.b);
+                    changed = true;
+                    continue;
+                }
+                if (inst.dst < 0) {
+                    continue;
+                }
+                Value v = evaluate(inst, state);
+                state[inst.dst] = v;
+                if (v.level == Constant && inst.op != IR_Const && (inst.isPure() || inst.op == IR_Div)) {
+                    inst = IRInst::make(IR_Const, inst.dst, -1, -1, v.constant);
+                    changed = true;
+                }
+            }
+        }
+        return changed;
+    }
+};
+
+/// Within each block, reads of a register that was copied from another read the original
+/// instead, as long as neither has been written since the copy. The copies left unread are
+/// then dead for DCE
+class CopyPropagation : public IRPass {
+public:
+    const char * name() const override {
+        return "copyprop";
+    }
+
+    bool run(IRFunction & func) override {
+        bool changed = false;
+        /// Live copies, (copy, original)
+        std::vector<std::pair<int32_t, int32_t> > copies;
+        for (IRBlock & block : func.blocks) {
+            copies.clear();
+            for (IRInst & inst : block.insts) {
+                func.forEachUse(inst, [&](int32_t & reg) {
+                    for (const std::pair<int32_t, int32_t> & copy : copies) {
+                        if (copy.first == reg) {
+                            reg = copy.second;
+                            changed = true;
+                            break;
+                        }
+                    }
+                });
+                if (inst.dst < 0) {
+                    continue;
+                }
+                for (size_t i = 0; i < copies.size(); ) {
+                    if (copies[i].first == inst.dst || copies[i].second == inst.dst) {
+                        copies[i] = copies.back();
+                        copies.pop_back();
+                    }
+                    else {
+                        i++;
+                    }
+                }
+                if (inst.op == IR_Copy && inst.a != inst.dst) {
+                    copies.push_back(std::make_pair(inst.dst, inst.a));
+                }
+            }
+        }
+        return changed;
+    }
+};
+
+/// Liveness over the blocks, then removal of the pure instructions whose result is never read
+class DeadCodeElimination : public IRPass {
+public:
+    const char * name() const override {
+        return "dce";
+    }
+
+    bool run(IRFunction & func) override {
+        std::vector<llvm::BitVector> in = liveIn(func);
+        bool removed = false;
+        for (size_t b = 0; b < func.blocks.size(); b++) {
+            llvm::BitVector live = liveOut(func, in, b);
+            std::vector<IRInst> & insts = func.blocks[b].insts;
+            std::vector<IRInst> kept;
+            kept.reserve(insts.size());
+            for (size_t i = insts.size(); i-- > 0; ) {
+                IRInst & inst = insts[i];
+                bool dead = inst.isPure() && (!live.test(inst.dst) || (inst.op == IR_Copy && inst.a == inst.dst));
+                if (dead) {
+                    removed = true;
+                    continue;
+                }
+                livenessStep(func, inst, live);
+                kept.push_back(inst);
+            }
+            insts.assign(kept.rbegin(), kept.rend());
+        }
+        return removed;
+    }
+};
+
+/// Branches to a block that only jumps on go straight to where it jumps, a CondBr with both
+/// targets the same becomes a Br, a block is merged into its only predecessor when that one
+/// jumps to it unconditionally, and blocks nothing reaches are dropped
+class SimplifyCFG : public IRPass {
+    /// Where a branch to block ends up after skipping blocks that only jump
+    static int32_t skip(const IRFunction & func, int32_t block) {
+        for (size_t hops = 0; hops < func.blocks.size(); hops++) {
+            const IRBlock & b = func.blocks[block];
+            if (b.insts.size() != 1 || b.terminator().op != IR_Br) {
+                break;
+            }
+            block = b.terminator().imm;
+        }
+        return block;
+    }
+
+    static bool thread(IRFunction & func) {
+        bool changed = false;
+        for (IRBlock & block : func.blocks) {
+            IRInst & term = block.terminator();
+            if (term.op == IR_Br || term.op == IR_CondBr) {
+                int32_t target = skip(func, term.imm);
+                changed |= target != term.imm;
+                term.imm = target;
+            }
+            if (term.op == IR_CondBr) {
+                int32_t target = skip(func, term.b);
+                changed |= target != term.b;
+                term.b = target;
+                if (term.b == term.imm) {
+                    term = IRInst::make(IR_Br, -1, -1, -1, term.imm);
+                    changed = true;
+                }
+            }
+        }
+        return changed;
+    }
+
+    static bool merge(IRFunction & func) {
+        bool changed = false;
+        std::vector<unsigned> preds = predecessorCounts(func);
+        for (size_t b = 0; b < func.blocks.size(); b++) {
+            IRBlock & block = func.blocks[b];
+            for (;;) {
+                const IRInst & term = block.terminator();
+                int32_t next = term.imm;
+                if (term.op != IR_Br || next == (int32_t)b || next == 0 || preds[next] != 1) {
+                    break;
+                }
+                std::vector<IRInst> & moved = func.blocks[next].insts;
+                block.insts.pop_back();
+                block.insts.insert(block.insts.end(), moved.begin(), moved.end());
+                /// The merged block is left unreachable, it jumps to itself until it is removed
+                moved.assign(1, IRInst::make(IR_Br, -1, -1, -1, next));
+                preds[next] = 0;
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    static bool removeUnreachable(IRFunction & func) {
+        size_t blocks = func.blocks.size();
+        std::vector<char> reached(blocks, 0);
+        std::vector<int32_t> stack(1, 0);
+        reached[0] = 1;
+        while (!stack.empty()) {
+            int32_t b = stack.back();
+            stack.pop_back();
+            int32_t succ[2];
+            func.blocks[b].successors(succ[0], succ[1]);
+            for (int32_t s : succ) {
+                if (s >= 0 && !reached[s]) {
+                    reached[s] = 1;
+                    stack.push_back(s);
+                }
+            }
+        }
+        std::vector<int32_t> index(blocks, -1);
+        size_t kept = 0;
+        for (size_t b = 0; b < blocks; b++) {
+            if (reached[b]) {
+                index[b] = kept;
+                if (kept != b) {
+                    func.blocks[kept] = std::move(func.blocks[b]);
+                }
+                kept++;
+            }
+        }
+        if (kept == blocks) {
+            return false;
+        }
+        func.blocks.resize(kept);
+        for (IRBlock & block : func.blocks) {
+            IRInst & term = block.terminator();
+            if (term.op == IR_Br || term.op == IR_CondBr) {
+                term.imm = index[term.imm];
+            }
+            if (term.op == IR_CondBr) {
+                term.b = index[term.b];
+            }
+        }
+        return true;
+    }
+public:
+    const char * name() const override {
+        return "simplifycfg";
+    }
+
+    bool run(IRFunction & func) override {
+        bool changed = thread(func);
+        changed |= merge(func);
+        changed |= removeUnreachable(func);
+        return changed;
+    }
+};
+
+/// Calls to small functions that cannot reach themselves through calls are replaced by a copy of
+/// the callee's body : the block of the call is split after it, the parameters become copies of
+/// the arguments, the callee's registers and local arrays are renumbered after the caller's and
+/// each return becomes a copy into the call's dst and a jump to the rest of the split block.
+/// The copies and jumps this leaves are what copyprop and simplifycfg clean up
+class Inliner : public IRPass {
+public:
+    /// Callees of at most this many instructions are inlined unless --inline-threshold says otherwise
+    static const unsigned kDefaultThreshold = 16;
+private:
+    /// Nothing more is inlined into a function of this many instructions
+    static const size_t kMaxCaller = 2000;
+
+    unsigned mThreshold;
+    const IRModule * mModule;
+    /// Functions that can reach themselves through calls. Inlining never changes which
+    /// functions a function reaches, so this holds for the whole run of the pass
+    std::vector<char> mRecursive;
+
+    void findRecursive() {
+        size_t count = mModule->functions.size();
+        std::vector<std::vector<int32_t> > callees(count);
+        for (size_t f = 0; f < count; f++) {
+            for (const IRBlock & block : mModule->functions[f].blocks) {
+                for (const IRInst & inst : block.insts) {
+                    if (inst.op == IR_Call) {
+                        callees[f].push_back(inst.imm);
+                    }
+                }
+            }
+        }
+        mRecursive.assign(count, 0);
+        for (size_t f = 0; f < count; f++) {
+            std::vector<char> seen(count, 0);
+            std::vector<int32_t> stack(callees[f]);
+            while (!stack.empty() && !mRecursive[f]) {
+                int32_t g = stack.back();
+                stack.pop_back();
+                if (g == (int32_t)f) {
+                    mRecursive[f] = 1;
+                }
+                else if (!seen[g]) {
+                    seen[g] = 1;
+                    stack.insert(stack.end(), callees[g].begin(), callees[g].end());
+                }
+            }
+        }
+    }
+
+    /// Replace the call at insts[i] of block b with the body of its callee
+    void inlineCall(IRFunction & func, size_t b, size_t i) {
+        IRInst call = func.blocks[b].insts[i];
+        const IRFunction & callee = mModule->functions[call.imm];
+        int32_t base = func.regs;
+        int64_t frame = func.frameBytes;
+        int32_t offset = func.blocks.size();
+        int32_t rest = offset + callee.blocks.size();
+        func.regs += callee.regs;
+        func.frameBytes += callee.frameBytes;
+
+        IRBlock tail;
+        std::vector<IRInst> & insts = func.blocks[b].insts;
+        tail.insts.assign(insts.begin() + i + 1, insts.end());
+        insts.resize(i);
+        for (int32_t k = 0; k < call.b && k < (int32_t)callee.params; k++) {
+            insts.push_back(IRInst::make(IR_Copy, base + k, func.args[call.a + k]));
+        }
+        insts.push_back(IRInst::make(IR_Br, -1, -1, -1, offset));
+
+        for (const IRBlock & block : callee.blocks) {
+            IRBlock copy;
+            copy.insts.reserve(block.insts.size() + 1);
+            for (IRInst inst : block.insts) {
+                if (inst.op == IR_Call) {
+                    int32_t first = func.args.size();
+                    for (int32_t k = 0; k < inst.b; k++) {
+                        func.args.push_back(callee.args[inst.a + k] + base);
+                    }
+                    inst.a = first;
+                }
+                else {
+                    func.forEachUse(inst, [&](int32_t & reg) {
+                        reg += base;
+                    });
+                }
+                if (inst.dst >= 0) {
+                    inst.dst += base;
+                }
+                if (inst.op == IR_Local) {
+                    inst.imm += frame;
+                }
+                else if (inst.op == IR_Br || inst.op == IR_CondBr) {
+                    inst.imm += offset;
+                    if (inst.op == IR_CondBr) {
+                        inst.b += offset;
+                    }
+                }
+                else if (inst.op == IR_Ret) {
+                    copy.insts.push_back(IRInst::make(IR_Copy, call.dst, inst.a));
+                    inst = IRInst::make(IR_Br, -1, -1, -1, rest);
+                }
+                copy.insts.push_back(inst);
+            }
+            func.blocks.push_back(std::move(copy));
+        }
+        func.blocks.push_back(std::move(tail));
+    }
+public:
+    explicit Inliner(unsigned threshold) : mThreshold(threshold), mModule(NULL), mRecursive() {
+    }
+
+    const char * name() const override {
+        return "inline";
+    }
+
+    void begin(const IRModule & module) override {
+        mModule = &module;
+        findRecursive();
+    }
+
+    bool run(IRFunction & func) override {
+        bool changed = false;
+        size_t size = func.size();
+        /// The blocks an inlined body adds are scanned too, so calls in it are inlined in turn
+        for (size_t b = 0; b < func.blocks.size(); b++) {
+            for (size_t i = 0; i < func.blocks[b].insts.size(); i++) {
+                const IRInst & inst = func.blocks[b].insts[i];
+                if (inst.op != IR_Call || mRecursive[inst.imm]) {
+                    continue;
+                }
+                size_t callee = mModule->functions[inst.imm].size();
+                if (callee > mThreshold || size + callee > kMaxCaller) {
+                    continue;
+                }
+                inlineCall(func, b, i);
+                size += callee;
+                changed = true;
+                /// The rest of the block moved to the last block
+                break;
+            }
+        }
+        return changed;
+    }
+};
+
+/// A natural loop : the header and every block that reaches a back edge to it without passing it
+struct IRLoop {
+    int32_t header;
+    /// By block, set for the blocks of the loop
+    std::vector<char> body;
+    std::vector<int32_t> blocks;
+
+    bool contains(int32_t block) const {
+        return block < (int32_t)body.size() && body[block];
+    }
+};
+
+/// The natural loops of func, innermost first. Back edges to the same header make one loop
+static inline std::vector<IRLoop> findLoops(const IRFunction & func) {
+    size_t count = func.blocks.size();
+    std::vector<std::vector<int32_t> > preds(count);
+    for (size_t b = 0; b < count; b++) {
+        int32_t succ[2];
+        func.blocks[b].successors(succ[0], succ[1]);
+        for (int32_t s : succ) {
+            if (s >= 0) {
+                preds[s].push_back(b);
+            }
+        }
+    }
+    std::vector<char> reached(count, 0);
+    std::vector<int32_t> stack(1, 0);
+    reached[0] = 1;
+    while (!stack.empty()) {
+        int32_t b = stack.back();
+        stack.pop_back();
+        int32_t succ[2];
+        func.blocks[b].successors(succ[0], succ[1]);
+        for (int32_t s : succ) {
+            if (s >= 0 && !reached[s]) {
+                reached[s] = 1;
+                stack.push_back(s);
+            }
+        }
+    }
+    /// Dominators, the blocks every path from the entry to a block goes through
+    std::vector<llvm::BitVector> dom(count, llvm::BitVector(count, true));
+    dom[0].reset();
+    dom[0].set(0);
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t b = 1; b < count; b++) {
+            if (!reached[b]) {
+                continue;
+            }
+            llvm::BitVector d(count, true);
+            for (int32_t p : preds[b]) {
+                if (reached[p]) {
+                    d &= dom[p];
+                }
+            }
+            d.set(b);
+            if (d != dom[b]) {
+                dom[b] = d;
+                changed = true;
+            }
+        }
+    }
+    std::vector<IRLoop> loops;
+    std::vector<int32_t> loopOf(count, -1);
+    for (size_t t = 0; t < count; t++) {
+        int32_t succ[2];
+        func.blocks[t].successors(succ[0], succ[1]);
+        for (int32_t h : succ) {
+            if (h < 0 || !reached[t] || !dom[t].test(h)) {
+                continue;
+            }
+            if (loopOf[h] < 0) {
+                loopOf[h] = loops.size();
+                loops.push_back(IRLoop());
+                loops.back().header = h;
+                loops.back().body.assign(count, 0);
+                loops.back().body[h] = 1;
+                loops.back().blocks.push_back(h);
+            }
+            IRLoop & loop = loops[loopOf[h]];
+            stack.assign(1, t);
+            while (!stack.empty()) {
+                int32_t b = stack.back();
+                stack.pop_back();
+                if (loop.body[b]) {
+                    continue;
+                }
+                loop.body[b] = 1;
+                loop.blocks.push_back(b);
+                for (int32_t p : preds[b]) {
+                    if (reached[p]) {
+                        stack.push_back(p);
+                    }
+                }
+            }
+        }
+    }
+    std::stable_sort(loops.begin(), loops.end(), [](const IRLoop & a, const IRLoop & b) {
+        return a.blocks.size() < b.blocks.size();
+    });
+    return loops;
+}
+
+/// Add a block that jumps to the header of loop and send every edge that enters the loop
+/// from outside through it. Return the new block
+static inline int32_t addPreheader(IRFunction & func, const IRLoop & loop) {
+    int32_t pre = func.blocks.size();
+    for (int32_t b = 0; b < pre; b++) {
+        if (loop.contains(b)) {
+            continue;
+        }
+        IRInst & term = func.blocks[b].terminator();
+        if ((term.op == IR_Br || term.op == IR_CondBr) && term.imm == loop.header) {
+            term.imm = pre;
+        }
+        if (term.op == IR_CondBr && term.b == loop.header) {
+            term.b = pre;
+        }
+    }
+    func.blocks.push_back(IRBlock());
+    func.blocks.back().insts.push_back(IRInst::make(IR_Br, -1, -1, -1, loop.header));
+    return pre;
+}
+
+/// Put insts at the end of block, before its terminator
+static inline void insertBeforeTerminator(IRFunction & func, int32_t block, const std::vector<IRInst> & insts) {
+    std::vector<IRInst> & code = func.blocks[block].insts;
+    code.insert(code.end() - 1, insts.begin(), insts.end());
+}
+
+/// Base class of the loop passes : each loop is transformed once, innermost first, with the
+/// loops found again after every transformation since it may add blocks
+class IRLoopPass : public IRPass {
+protected:
+    /// Transform loop, return true if func changed
+    virtual bool runOnLoop(IRFunction & func, const IRLoop & loop) = 0;
+
+    /// Definitions of each register inside loop
+    static std::vector<unsigned> loopDefs(const IRFunction & func, const IRLoop & loop) {
+        std::vector<unsigned> defs(func.regs, 0);
+        for (int32_t b : loop.blocks) {
+            for (const IRInst & inst : func.blocks[b].insts) {
+                if (inst.dst >= 0) {
+                    defs[inst.dst]++;
+                }
+            }
+        }
+        return defs;
+    }
+public:
+    bool run(IRFunction & func) override {
+        bool changed = false;
+        std::vector<char> done;
+        for (;;) {
+            std::vector<IRLoop> loops = findLoops(func);
+            done.resize(func.blocks.size(), 0);
+            const IRLoop * next = NULL;
+            for (const IRLoop & loop : loops) {
+                /// A loop at the entry has no place for a preheader
+                if (!done[loop.header] && loop.header != 0) {
+                    next = &loop;
+                    break;
+                }
+            }
+            if (!next) {
+                return changed;
+            }
+            done[next->header] = 1;
+            changed |= runOnLoop(func, *next);
+        }
+    }
+};
+
+/// Loop invariant code motion. An instruction moves from a loop to its preheader when it is
+/// the only definition of its dst in the loop, its dst is not live into the header or out of
+/// the loop, and no operand is defined in the loop (counting what already moved out).
+/// Pure instructions always qualify. A load qualifies only from the header, which runs whenever
+/// the preheader does, and only if the loop has no call, FREE or clearing of an array, and each
+/// of its stores goes to a global that the load does not overlap; any store through another
+/// pointer keeps every load in the loop
+class LoopInvariantCodeMotion : public IRLoopPass {
+    /// For each register, the offset of the global whose address is its only definition, -1 otherwise
+    static std::vector<int64_t> globalAddresses(const IRFunction & func) {
+        std::vector<int64_t> global(func.regs, -1);
+        std::vector<unsigned> defs(func.regs, 0);
+        for (const IRBlock & block : func.blocks) {
+            for (const IRInst & inst : block.insts) {
+                if (inst.dst >= 0 && defs[inst.dst]++ == 0 && inst.op == IR_Global) {
+                    global[inst.dst] = inst.imm;
+                }
+                else if (inst.dst >= 0) {
+                    global[inst.dst] = -1;
+                }
+            }
+        }
+        return global;
+    }
+protected:
+    bool runOnLoop(IRFunction & func, const IRLoop & loop) override {
+        std::vector<llvm::BitVector> in = liveIn(func);
+        std::vector<unsigned> defs = loopDefs(func, loop);
+        std::vector<int64_t> global = globalAddresses(func);
+        /// Ranges of the globals the loop stores to, and whether it may write anywhere else
+        std::vector<std::pair<int64_t, int64_t> > stored;
+        bool clobbers = false;
+        llvm::BitVector exitLive(func.regs);
+        for (int32_t b : loop.blocks) {
+            for (const IRInst & inst : func.blocks[b].insts) {
+                if (inst.op == IR_Store && global[inst.a] >= 0) {
+                    stored.push_back(std::make_pair(global[inst.a], global[inst.a] + inst.imm));
+                }
+                else if (inst.op == IR_Store || inst.op == IR_Call || inst.op == IR_Free || inst.op == IR_Zero) {
+                    clobbers = true;
+                }
+            }
+            int32_t succ[2];
+            func.blocks[b].successors(succ[0], succ[1]);
+            for (int32_t s : succ) {
+                if (s >= 0 && !loop.contains(s)) {
+                    exitLive |= in[s];
+                }
+            }
+        }
+        const llvm::BitVector & headerLive = in[loop.header];
+
+        auto invariant = [&](IRInst & inst, int32_t block) {
+            if (inst.dst < 0 || defs[inst.dst] != 1 || headerLive.test(inst.dst) || exitLive.test(inst.dst)) {
+                return false;
+            }
+            bool operands = true;
+            func.forEachUse(inst, [&](int32_t & reg) {
+                operands = operands && defs[reg] == 0;
+            });
+            if (!operands) {
+                return false;
+            }
+            if (inst.isPure()) {
+                return true;
+            }
+            if ((inst.op != IR_Load && inst.op != IR_LoadS) || block != loop.header || clobbers) {
+                return false;
+            }
+            if (stored.empty()) {
+                return true;
+            }
+            int64_t addr = global[inst.a];
+            if (addr < 0) {
+                return false;
+            }
+            for (const std::pair<int64_t, int64_t> & range : stored) {
+                if (addr < range.second && range.first < addr + inst.imm) {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        std::vector<IRInst> hoisted;
+        bool moved = true;
+        while (moved) {
+            moved = false;
+            for (int32_t b : loop.blocks) {
+                std::vector<IRInst> & insts = func.blocks[b].insts;
+                for (size_t i = 0; i < insts.size(); ) {
+                    if (invariant(insts[i], b)) {
+                        defs[insts[i].dst]--;
+                        hoisted.push_back(insts[i]);
+                        insts.erase(insts.begin() + i);
+                        moved = true;
+                    }
+                    else {
+                        i++;
+                    }
+                }
+            }
+        }
+        if (hoisted.empty()) {
+            return false;
+        }
+        insertBeforeTerminator(func, addPreheader(func, loop), hoisted);
+        return true;
+    }
+public:
+    const char * name() const override {
+        return "licm";
+    }
+};
+
+/// Strength reduction of induction variables. A basic induction variable i has one definition in
+/// the loop, i = i + s or i = i - s with s invariant. A product t = i * k with k invariant is
+/// replaced by a register kept equal to i * k : set in the preheader and stepped by s * k right
+/// after the definition of i. When the product only feeds a following base + t with base
+/// invariant, as array subscripts and pointer arithmetic lower to, the register tracks the whole
+/// address instead, so the loop steps a pointer. Run it after licm, which moves the constant
+/// operands out of the loop
+class StrengthReduction : public IRLoopPass {
+    struct Reduction {
+        int32_t iv;
+        int32_t step;
+        bool down;
+        int32_t scale;
+        /// -1 if the register tracks only the product
+        int32_t base;
+        /// The instruction that now copies the new register
+        int32_t block;
+        size_t index;
+        int32_t reg;
+    };
+protected:
+    bool runOnLoop(IRFunction & func, const IRLoop & loop) override {
+        std::vector<unsigned> defs = loopDefs(func, loop);
+        std::vector<unsigned> uses(func.regs, 0);
+        /// Where each register is defined in the loop
+        std::vector<std::pair<int32_t, size_t> > where(func.regs, std::make_pair(-1, 0));
+        for (size_t b = 0; b < func.blocks.size(); b++) {
+            std::vector<IRInst> & insts = func.blocks[b].insts;
+            for (size_t i = 0; i < insts.size(); i++) {
+                func.forEachUse(insts[i], [&](int32_t & reg) {
+                    uses[reg]++;
+                });
+                if (insts[i].dst >= 0 && loop.contains(b)) {
+                    where[insts[i].dst] = std::make_pair((int32_t)b, i);
+                }
+            }
+        }
+        /// The step of reg if it is a basic induction variable
+        auto induction = [&](int32_t reg, int32_t & step, bool & down) {
+            if (defs[reg] != 1) {
+                return false;
+            }
+            const IRInst & def = func.blocks[where[reg].first].insts[where[reg].second];
+            if ((def.op == IR_Add || def.op == IR_Sub) && def.a == reg && defs[def.b] == 0) {
+                step = def.b;
+                down = def.op == IR_Sub;
+                return true;
+            }
+            if (def.op == IR_Add && def.b == reg && defs[def.a] == 0) {
+                step = def.a;
+                down = false;
+                return true;
+            }
+            return false;
+        };
+
+        std::vector<Reduction> reductions;
+        for (int32_t b : loop.blocks) {
+            std::vector<IRInst> & insts = func.blocks[b].insts;
+            for (size_t i = 0; i < insts.size(); i++) {
+                const IRInst & mul = insts[i];
+                if (mul.op != IR_Mul || defs[mul.dst] != 1 || uses[mul.dst] == 0) {
+                    continue;
+                }
+                Reduction r = { -1, -1, false, -1, -1, b, i, -1 };
+                if (induction(mul.a, r.step, r.down) && defs[mul.b] == 0) {
+                    r.iv = mul.a;
+                    r.scale = mul.b;
+                }
+                else if (induction(mul.b, r.step, r.down) && defs[mul.a] == 0) {
+                    r.iv = mul.b;
+                    r.scale = mul.a;
+                }
+                else {
+                    continue;
+                }
+                if (uses[mul.dst] == 1 && i + 1 < insts.size()) {
+                    const IRInst & add = insts[i + 1];
+                    if (add.op == IR_Add && defs[add.dst] == 1 && add.a != add.b &&
+                        (add.a == mul.dst || add.b == mul.dst)) {
+                        int32_t base = add.a == mul.dst ? add.b : add.a;
+                        if (defs[base] == 0) {
+                            r.base = base;
+                            r.index = i + 1;
+                        }
+                    }
+                }
+                reductions.push_back(r);
+            }
+        }
+        if (reductions.empty()) {
+            return false;
+        }
+
+        int32_t pre = addPreheader(func, loop);
+        std::vector<IRInst> setup;
+        /// Increments to insert, by block and position of the definition of their induction variable
+        std::vector<std::pair<std::pair<int32_t, size_t>, IRInst> > steps;
+        for (Reduction & r : reductions) {
+            r.reg = func.newReg();
+            int32_t product = func.newReg();
+            setup.push_back(IRInst::make(IR_Mul, r.base >= 0 ? product : r.reg, r.iv, r.scale));
+            if (r.base >= 0) {
+                setup.push_back(IRInst::make(IR_Add, r.reg, r.base, product));
+            }
+            int32_t delta = func.newReg();
+            setup.push_back(IRInst::make(IR_Mul, delta, r.step, r.scale));
+            steps.push_back(std::make_pair(where[r.iv], IRInst::make(r.down ? IR_Sub : IR_Add, r.reg, r.reg, delta)));
+            IRInst & replaced = func.blocks[r.block].insts[r.index];
+            replaced = IRInst::make(IR_Copy, replaced.dst, r.reg);
+        }
+        insertBeforeTerminator(func, pre, setup);
+        /// From the back, so the positions of the ones left stay valid
+        std::stable_sort(steps.begin(), steps.end(), [](const std::pair<std::pair<int32_t, size_t>, IRInst> & a,
+                                                        const std::pair<std::pair<int32_t, size_t>, IRInst> & b) {
+            return a.first > b.first;
+        });
+        for (const std::pair<std::pair<int32_t, size_t>, IRInst> & step : steps) {
+            std::vector<IRInst> & insts = func.blocks[step.first.first].insts;
+            insts.insert(insts.begin() + step.first.second + 1, step.second);
+        }
+        return true;
+    }
+public:
+    const char * name() const override {
+        return "strength";
+    }
+};
+
+/// Runs a pipeline of passes over every function of a module, and keeps the time each pass
+/// took and how many instructions it removed (or added) over all its runs
+class IRPassManager {
+    struct Stat {
+        unsigned runs;
+        unsigned changed;
+        double ms;
+        int64_t before;
+        int64_t after;
+    };
+
+    /// The pipeline runs again while it changes something, at most this many times
+    static const unsigned kRounds = 4;
+
+    unsigned mInlineThreshold;
+    std::vector<std::unique_ptr<IRPass> > mPasses;
+    std::vector<Stat> mStats;
+    int64_t mBefore;
+    int64_t mAfter;
+public:
+    explicit IRPassManager(unsigned inlineThreshold = Inliner::kDefaultThreshold)
+            : mInlineThreshold(inlineThreshold), mPasses(), mStats(), mBefore(0), mAfter(0) {
+    }
+
+    /// The pass called name, NULL if there is none
+    std::unique_ptr<IRPass> create(const std::string & name) const {
+        if (name == "inline") {
+            return std::unique_ptr<IRPass>(new Inliner(mInlineThreshold));
+        }
+        if (name == "constprop") {
+            return std::unique_ptr<IRPass>(new ConstantPropagation());
+        }
+        if (name == "copyprop") {
+            return std::unique_ptr<IRPass>(new CopyPropagation());
+        }
+        if (name == "dce") {
+            return std::unique_ptr<IRPass>(new DeadCodeElimination());
+        }
+        if (name == "simplifycfg") {
+            return std::unique_ptr<IRPass>(new SimplifyCFG());
+        }
+        if (name == "licm") {
+            return std::unique_ptr<IRPass>(new LoopInvariantCodeMotion());
+        }
+        if (name == "strength") {
+            return std::unique_ptr<IRPass>(new StrengthReduction());
+        }
+        return std::unique_ptr<IRPass>();
+    }
+
+    void add(std::unique_ptr<IRPass> pass) {
+        Stat stat = { 0, 0, 0, 0, 0 };
+        mPasses.push_back(std::move(pass));
+        mStats.push_back(stat);
+    }
+
+    /// Set up the passes of a comma separated list, "none" for no pass.
+    /// Return false and the offending name in unknown if a pass does not exist
+    bool parse(const std::string & list, std::string & unknown) {
+        if (list == "none" || list.empty()) {
+            return true;
+        }
+        size_t begin = 0;
+        while (begin <= list.size()) {
+            size_t end = list.find(',', begin);
+            if (end == std::string::npos) {
+                end = list.size();
+            }
+            std::string name = list.substr(begin, end - begin);
+            std::unique_ptr<IRPass> pass = create(name);
+            if (!pass) {
+                unknown = name;
+                return false;
+            }
+            add(std::move(pass));
+            begin = end + 1;
+        }
+        return true;
+    }
+
+    void run(IRModule & module) {
+        mBefore += module.size();
+        for (std::unique_ptr<IRPass> & pass : mPasses) {
+            pass->begin(module);
+        }
+        for (IRFunction & func : module.functions) {
+            for (unsigned round = 0; round < kRounds; round++) {
+                bool changed = false;
+                for (size_t i = 0; i < mPasses.size(); i++) {
+                    Stat & stat = mStats[i];
+                    int64_t before = func.size();
+                    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                    bool did = mPasses[i]->run(func);
+                    stat.ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                    stat.runs++;
+                    stat.changed += did;
+                    stat.before += before;
+                    stat.after += func.size();
+                    changed |= did;
+                }
+                if (!changed) {
+                    break;
+                }
+            }
+        }
+        mAfter += module.size();
+    }
+
+    /// Per pass : runs, runs that changed the function, time and instructions before and after,
+    /// summed over functions and rounds. format is "table" or "json"
+    void print(llvm::raw_ostream & os, const std::string & format) const {
+        if (format == "json") {
+            os << "{\"before\":" << mBefore << ",\"after\":" << mAfter << ",\"passes\":[";
+            for (size_t i = 0; i < mPasses.size(); i++) {
+                const Stat & stat = mStats[i];
+                os << (i ? "," : "") << "{\"name\":\"" << mPasses[i]->name() << "\",\"runs\":" << stat.runs
+                   << ",\"changed\":" << stat.changed << ",\"ms\":" << llvm::format("%.3f", stat.ms)
+                   << ",\"before\":" << stat.before << ",\"after\":" << stat.after << "}";
+            }
+            os << "]}\n";
+            return;
+        }
+        os << "[PASSES] " << mBefore << " instructions before, " << mAfter << " after\n";
+        os << "  pass           runs  changed         ms       before        after    delta\n";
+        for (size_t i = 0; i < mPasses.size(); i++) {
+            const Stat & stat = mStats[i];
+            os << llvm::format("  %-12s %6u %8u %10.3f %12lld %12lld %8lld\n", mPasses[i]->name(), stat.runs,
+                               stat.changed, stat.ms, (long long)stat.before, (long long)stat.after,
+                               (long long)(stat.after - stat.before));
+        }
+    }
+};
+
+#endif //ASSIGN1_IRPASSES_H
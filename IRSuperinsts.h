@@ -0,0 +1,42 @@
+// Generated by bench/gen_superinsts.py from its hand-picked DEFAULTS, without a profile. Do not edit.
+
+#ifndef ASSIGN1_IRSUPERINSTS_H
+#define ASSIGN1_IRSUPERINSTS_H
+
+#include <stdint.h>
+
+#include "IR.h"
+
+/// Superinstructions of the IR interpreter, numbered after the IROps. Each one runs a
+/// sequence of instructions in one dispatch, see fuseSuperinsts
+enum IRSuperOp : uint8_t {
+    IR_ConstAdd = IR_NumOps,
+    IR_LtCondBr,
+    IR_ConstLtCondBr,
+    IR_GtCondBr,
+    IR_EqCondBr,
+    IR_AddBr,
+    IR_GlobalLoadS,
+    IR_MulAddLoadS,
+    IR_NumSuperOps
+};
+
+struct IRSuperinst {
+    uint8_t op;
+    uint8_t length;
+    IROp ops[3];
+};
+
+/// The sequence each superinstruction runs
+static const IRSuperinst kIRSuperinsts[] = {
+    { IR_ConstAdd, 2, { IR_Const, IR_Add, IR_NumOps } },
+    { IR_LtCondBr, 2, { IR_Lt, IR_CondBr, IR_NumOps } },
+    { IR_ConstLtCondBr, 3, { IR_Const, IR_Lt, IR_CondBr } },
+    { IR_GtCondBr, 2, { IR_Gt, IR_CondBr, IR_NumOps } },
+    { IR_EqCondBr, 2, { IR_Eq, IR_CondBr, IR_NumOps } },
+    { IR_AddBr, 2, { IR_Add, IR_Br, IR_NumOps } },
+    { IR_GlobalLoadS, 2, { IR_Global, IR_LoadS, IR_NumOps } },
+    { IR_MulAddLoadS, 3, { IR_Mul, IR_Add, IR_LoadS } },
+};
+
+#endif //ASSIGN1_IRSUPERINSTS_H
@@ -0,0 +1,221 @@
+//
+// Created by Critizero on 2021/10/22.
+//
+
+#ifndef ASSIGN1_MEMO_H
+#define ASSIGN1_MEMO_H
+
+#include <stdint.h>
+#include <deque>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "clang/AST/Decl.h"
+#include "clang/AST/RecursiveASTVisitor.h"
+
+using namespace clang;
+
+/// Decide whether a single function body is pure on its own.
+/// Calls to other guest functions are collected, the caller decides about them.
+class PurityVisitor : public RecursiveASTVisitor<PurityVisitor> {
+    bool mPure;
+    std::set<FunctionDecl *> mCallees;
+public:
+    PurityVisitor() : mPure(true), mCallees() {
+    }
+
+    bool isPure() {
+        return mPure;
+    }
+    const std::set<FunctionDecl *> & getCallees() {
+        return mCallees;
+    }
+
+    /// Locals and parameters of the function itself are the only state it may touch
+    bool isLocal(Decl * decl) {
+        if (VarDecl * vdecl = dyn_cast<VarDecl>(decl)) {
+            return !vdecl->hasGlobalStorage();
+        }
+        return false;
+    }
+
+    bool VisitDeclRefExpr(DeclRefExpr * expr) {
+        Decl * decl = expr->getFoundDecl();
+        if (isa<VarDecl>(decl) && !isLocal(decl)) {
+            /// Reading a global makes the result depend on more than the arguments
+            mPure = false;
+        }
+        return mPure;
+    }
+    bool VisitUnaryOperator(UnaryOperator * uop) {
+        if (uop->getOpcode() == UO_Deref) {
+            mPure = false;
+        }
+        return mPure;
+    }
+    bool VisitArraySubscriptExpr(ArraySubscriptExpr * array) {
+        /// Only arrays declared inside the function itself
+        DeclRefExpr * base = dyn_cast<DeclRefExpr>(array->getLHS()->IgnoreImpCasts());
+        if (!base || !isLocal(base->getFoundDecl()) ||
+            !base->getType()->isArrayType()) {
+            mPure = false;
+        }
+        return mPure;
+    }
+    bool VisitCallExpr(CallExpr * call) {
+        FunctionDecl * callee = call->getDirectCallee();
+        if (!callee || !callee->getBody()) {
+            /// Built-in functions (GET, PRINT, MALLOC, FREE) have side effects
+            mPure = false;
+        }
+        else {
+            mCallees.insert(callee->getCanonicalDecl());
+        }
+        return mPure;
+    }
+};
+
+/// Find the guest functions whose result only depends on their arguments
+class PurityAnalysis {
+    std::set<FunctionDecl *> mPure;
+public:
+    PurityAnalysis() : mPure() {
+    }
+
+    void analyze(TranslationUnitDecl * unit) {
+        std::map<FunctionDecl *, std::set<FunctionDecl *> > callees;
+        for (TranslationUnitDecl::decl_iterator i = unit->decls_begin(), e = unit->decls_end(); i != e; ++ i) {
+            FunctionDecl * fdecl = dyn_cast<FunctionDecl>(*i);
+            if (!fdecl || !fdecl->getBody() || fdecl->getName().equals("main")) {
+                continue;
+            }
+            if (!fdecl->getReturnType()->isIntegerType()) {
+                continue;
+            }
+            PurityVisitor visitor;
+            visitor.TraverseStmt(fdecl->getBody());
+            if (visitor.isPure()) {
+                FunctionDecl * canon = fdecl->getCanonicalDecl();
+                mPure.insert(canon);
+                callees[canon] = visitor.getCallees();
+            }
+        }
+        /// Optimistic for recursion: drop functions calling an impure one until nothing changes
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (auto i = callees.begin(); i != callees.end(); ++ i) {
+                if (!mPure.count(i->first)) {
+                    continue;
+                }
+                for (FunctionDecl * callee : i->second) {
+                    if (!mPure.count(callee)) {
+                        mPure.erase(i->first);
+                        changed = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    bool isPure(FunctionDecl * fdecl) const {
+        return mPure.count(fdecl->getCanonicalDecl()) != 0;
+    }
+    size_t size() const {
+        return mPure.size();
+    }
+};
+
+/// Bounded cache from (function, arguments) to the returned value
+class MemoCache {
+    struct Key {
+        FunctionDecl * func;
+        std::vector<int64_t> args;
+        bool operator==(const Key & other) const {
+            return func == other.func && args == other.args;
+        }
+    };
+    struct KeyHash {
+        size_t operator()(const Key & key) const {
+            size_t h = std::hash<void *>()(key.func);
+            for (int64_t arg : key.args) {
+                h = h * 31 + std::hash<int64_t>()(arg);
+            }
+            return h;
+        }
+    };
+    struct Counter {
+        uint64_t hits;
+        uint64_t misses;
+    };
+
+    std::unordered_map<Key, int64_t, KeyHash> mEntries;
+    /// Insertion order, the oldest entry is evicted first
+    std::deque<Key> mOrder;
+    std::map<FunctionDecl *, Counter> mCounters;
+    size_t mCapacity;
+    size_t mArgWords;
+    uint64_t mEvictions;
+public:
+    explicit MemoCache(size_t capacity) : mEntries(), mOrder(), mCounters(), mCapacity(capacity),
+                                          mArgWords(0), mEvictions(0) {
+    }
+
+    bool lookup(FunctionDecl * func, const std::vector<int64_t> & args, int64_t & val) {
+        Key key = {func->getCanonicalDecl(), args};
+        auto it = mEntries.find(key);
+        Counter & counter = mCounters[key.func];
+        if (it == mEntries.end()) {
+            counter.misses++;
+            return false;
+        }
+        counter.hits++;
+        val = it->second;
+        return true;
+    }
+
+    void insert(FunctionDecl * func, const std::vector<int64_t> & args, int64_t val) {
+        if (mCapacity == 0) {
+            return;
+        }
+        Key key = {func->getCanonicalDecl(), args};
+        if (!mEntries.emplace(key, val).second) {
+            return;
+        }
+        mArgWords += args.size();
+        mOrder.push_back(key);
+        if (mEntries.size() > mCapacity) {
+            mArgWords -= mOrder.front().args.size();
+            mEntries.erase(mOrder.front());
+            mOrder.pop_front();
+            mEvictions++;
+        }
+    }
+
+    /// Approximate bytes held by the cache, keys are stored twice
+    size_t memoryUsage() {
+        size_t node = sizeof(Key) + sizeof(int64_t) + 2 * sizeof(void *);
+        return mEntries.size() * (node + sizeof(Key)) + 2 * mArgWords * sizeof(int64_t) +
+               mEntries.bucket_count() * sizeof(void *);
+    }
+
+    void print(llvm::raw_ostream & os) {
+        uint64_t hits = 0, misses = 0;
+        for (auto i = mCounters.begin(); i != mCounters.end(); ++ i) {
+            hits += i->second.hits;
+            misses += i->second.misses;
+            uint64_t total = i->second.hits + i->second.misses;
+            os << "[MEMO] " << i->first->getName() << ": " << i->second.hits << " hits / "
+               << total << " calls (" << (total ? 100 * i->second.hits / total : 0) << "%)\n";
+        }
+        uint64_t total = hits + misses;
+        os << "[MEMO] total: " << hits << " hits / " << total << " calls ("
+           << (total ? 100 * hits / total : 0) << "%), " << mEntries.size() << " entries, "
+           << mEvictions << " evictions, ~" << memoryUsage() << " bytes\n";
+    }
+};
+
+#endif //ASSIGN1_MEMO_H
@@ -0,0 +1,59 @@
+//
+// Created by Critizero on 2021/10/22.
+//
+
+#ifndef ASSIGN1_OPPROFILE_H
+#define ASSIGN1_OPPROFILE_H
+
+#include <stdint.h>
+#include <string>
+
+#include "llvm/Support/raw_ostream.h"
+
+#include "IR.h"
+
+/// Dynamic counts of the IR opcode pairs and triples that run one right after the other in the
+/// linked code, so that one dispatch could run them. bench/gen_superinsts.py picks the
+/// superinstructions from them. Written with --op-profile, one "length op... count" line each
+class OpProfile {
+    uint64_t mPairs[IR_NumOps][IR_NumOps];
+    uint64_t mTriples[IR_NumOps][IR_NumOps][IR_NumOps];
+public:
+    OpProfile() : mPairs(), mTriples() {
+    }
+
+    /// op ran after first and second, each IR_NumOps if the one before was not next to it in the code
+    void record(IROp first, IROp second, IROp op) {
+        if (second == IR_NumOps) {
+            return;
+        }
+        mPairs[second][op]++;
+        if (first != IR_NumOps) {
+            mTriples[first][second][op]++;
+        }
+    }
+
+    bool write(const std::string & path) const {
+        std::error_code ec;
+        llvm::raw_fd_ostream os(path, ec);
+        if (ec) {
+            return false;
+        }
+        for (unsigned a = 0; a < IR_NumOps; a++) {
+            for (unsigned b = 0; b < IR_NumOps; b++) {
+                if (mPairs[a][b]) {
+                    os << "2 " << IRInst::name((IROp)a) << " " << IRInst::name((IROp)b) << " " << mPairs[a][b] << "\n";
+                }
+                for (unsigned c = 0; c < IR_NumOps; c++) {
+                    if (mTriples[a][b][c]) {
+                        os << "3 " << IRInst::name((IROp)a) << " " << IRInst::name((IROp)b) << " "
+                           << IRInst::name((IROp)c) << " " << mTriples[a][b][c] << "\n";
+                    }
+                }
+            }
+        }
+        return !os.has_error();
+    }
+};
+
+#endif //ASSIGN1_OPPROFILE_H
@@ -0,0 +1,294 @@
+//
+// Created by Critizero on 2021/10/22.
+//
+
+#ifndef ASSIGN1_OPTIONS_H
+#define ASSIGN1_OPTIONS_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "llvm/Support/raw_ostream.h"
+
+/// Command line options of the interpreter
+struct InterpreterOptions {
+    /// Path of the program, or the program text itself
+    std::string program;
+    /// Cache the results of pure guest functions
+    bool memoize;
+    /// Maximum number of cached results
+    size_t memoCapacity;
+    /// Write sampled guest stacks in folded format to this file
+    std::string profile;
+    /// Sampling frequency of the profiler
+    unsigned profileHz;
+    /// Print execution counters at exit, "table" or "json"
+    std::string stats;
+    /// Print wall / CPU time and peak RSS of each phase, "table" or "json"
+    std::string phaseTimes;
+    /// Where PRINT writes, "stderr" or "stdout"
+    std::string printTo;
+    /// Read GET values from this file ("-" for stdin) without prompting
+    std::string input;
+    /// Run many programs in one process, see Batch.h
+    bool batch;
+    /// Programs of the batch given on the command line
+    std::vector<std::string> batchPrograms;
+    /// File listing the programs of the batch, one "program [input]" per line
+    std::string manifest;
+    /// Where the batch results go, "-" for stdout
+    std::string results;
+    /// Run the program once for each input file listed here, sharing one parsed AST
+    std::string inputs;
+    /// Worker threads of a batch or of --inputs
+    unsigned jobs;
+    /// "ast" walks the AST per input, "simt" runs --lanes inputs in lockstep (with --inputs),
+    /// "ir" lowers the program to the IR, optimizes it and runs that
+    std::string engine;
+    /// Inputs per lockstep group of the simt engine
+    unsigned lanes;
+    /// Save the AST and the state after init here (and to FILE.ast) before running main
+    std::string saveSnapshot;
+    /// Skip parsing and init : run main from a snapshot written by --save-snapshot
+    std::string restore;
+    /// Guest pointers stored in guest memory take 4 bytes, the guest memory is capped at 4 GiB
+    bool ptr32;
+    /// IR passes run by --engine=ir, comma separated, "none" for none
+    std::string passes;
+    /// Functions of at most this many IR instructions are inlined by the inline pass
+    unsigned inlineThreshold;
+    /// Print time and instruction counts of each IR pass, "table" or "json"
+    std::string passStats;
+    /// Print the IR after the passes
+    bool dumpIR;
+    /// Fuse common IR instruction sequences into superinstructions, see IRSuperinsts.h
+    bool superinsts;
+    /// Write the counts of the IR opcode pairs and triples that ran to this file, see OpProfile.h
+    std::string opProfile;
+    /// The AST engine specializes expression nodes after their first execution, see Quicken.h
+    bool quicken;
+    /// Print how many operations ran quickened
+    bool quickenStats;
+
+    InterpreterOptions() : program(), memoize(false), memoCapacity(1 << 16), profile(), profileHz(1000),
+                           stats(), phaseTimes(), printTo("stderr"), input(),
+                           batch(false), batchPrograms(), manifest(), results("-"), inputs(), jobs(1), engine("ast"), lanes(8),
+                           saveSnapshot(), restore(), ptr32(false), passes("inline,constprop,copyprop,dce,simplifycfg,licm,strength"),
+                           inlineThreshold(16), passStats(), dumpIR(false), superinsts(true), opProfile(), quicken(true), quickenStats(false) {
+    }
+
+    static void usage(const char * name) {
+        llvm::errs() << "Usage: " << name << " [options] <file | code>\n"
+                     << "       " << name << " --restore=SNAPSHOT [options]\n"
+                     << "       " << name << " --batch[=MANIFEST] [options] [file...]\n"
+                     << "  --memoize[=N]    cache results of pure functions (at most N entries)\n"
+                     << "  --profile=FILE   sample the guest call stack, write folded stacks to FILE\n"
+                     << "  --profile-hz=N   sampling frequency of --profile (default 1000)\n"
+                     << "  --stats[=json]   print execution counters at exit (needs -DENABLE_STATS=ON)\n"
+                     << "  --phase-times[=json]  print time and peak RSS of read, parse+sema, init, execute\n"
+                     << "  --print-to=stdout|stderr  where PRINT writes (default stderr)\n"
+                     << "  --input=FILE|-   read all GET values from FILE or stdin at once, no prompt\n"
+                     << "  --batch[=MANIFEST]  run every file (and every \"program [input]\" line of MANIFEST)\n"
+                     << "                   in this process, one JSON line per program in the results\n"
+                     << "  --results=FILE   where --batch writes its results (default stdout)\n"
+                     << "  --inputs=LIST    parse the program once and run it for every input file in LIST,\n"
+                     << "                   one JSON line per input in the results\n"
+                     << "  --engine=ast|simt|ir  simt runs --lanes inputs of --inputs in lockstep,\n"
+                     << "                   ir runs the program lowered to an optimized IR\n"
+                     << "  --passes=LIST    IR passes of --engine=ir, comma separated or none\n"
+                     << "                   (default inline,constprop,copyprop,dce,simplifycfg,licm,strength)\n"
+                     << "  --inline-threshold=N  inline callees of at most N IR instructions (default 16)\n"
+                     << "  --pass-stats[=json]  print time and instruction counts of each IR pass\n"
+                     << "  --dump-ir        print the IR after the passes\n"
+                     << "  --no-superinsts  run every IR instruction on its own, without superinstructions\n"
+                     << "  --op-profile=FILE  write the counts of IR opcode pairs and triples that ran to FILE\n"
+                     << "  --no-quicken     do not specialize AST nodes after their first execution\n"
+                     << "  --quicken-stats  print how many operations ran in specialized form\n"
+                     << "  --lanes=K        inputs per lockstep group of --engine=simt (default 8)\n"
+                     << "  --save-snapshot=FILE  save the AST (FILE.ast) and the globals and heap after\n"
+                     << "                   global initialization (FILE), then run main\n"
+                     << "  --restore=FILE   run main from a snapshot, without parsing or initializing\n"
+                     << "  --ptr32          store guest pointers in 4 bytes, guest memory is limited to 4 GiB\n"
+                     << "  --jobs[=N]       run the batch or the inputs on N threads (default 1, all cores without N)\n";
+    }
+
+    /// Parse the command line, return false on error
+    bool parse(int argc, char ** argv) {
+        for (int i = 1; i < argc; i++) {
+            const char * arg = argv[i];
+            if (strncmp(arg, "--", 2) != 0) {
+                batchPrograms.push_back(arg);
+            }
+            else if (strcmp(arg, "--batch") == 0) {
+                batch = true;
+            }
+            else if (strncmp(arg, "--batch=", 8) == 0) {
+                batch = true;
+                manifest = arg + 8;
+            }
+            else if (strncmp(arg, "--results=", 10) == 0) {
+                results = arg + 10;
+            }
+            else if (strncmp(arg, "--inputs=", 9) == 0) {
+                inputs = arg + 9;
+            }
+            else if (strncmp(arg, "--engine=", 9) == 0) {
+                engine = arg + 9;
+                if (engine != "ast" && engine != "simt" && engine != "ir") {
+                    llvm::errs() << "[ERROR] Unknown Engine: " << engine << "\n";
+                    return false;
+                }
+            }
+            else if (strncmp(arg, "--lanes=", 8) == 0) {
+                lanes = strtoul(arg + 8, NULL, 10);
+                if (lanes == 0) {
+                    llvm::errs() << "[ERROR] Invalid Lanes: " << arg + 8 << "\n";
+                    return false;
+                }
+            }
+            else if (strncmp(arg, "--save-snapshot=", 16) == 0) {
+                saveSnapshot = arg + 16;
+            }
+            else if (strncmp(arg, "--restore=", 10) == 0) {
+                restore = arg + 10;
+            }
+            else if (strcmp(arg, "--ptr32") == 0) {
+                ptr32 = true;
+            }
+            else if (strncmp(arg, "--passes=", 9) == 0) {
+                passes = arg + 9;
+            }
+            else if (strncmp(arg, "--inline-threshold=", 19) == 0) {
+                inlineThreshold = strtoul(arg + 19, NULL, 10);
+            }
+            else if (strcmp(arg, "--pass-stats") == 0) {
+                passStats = "table";
+            }
+            else if (strncmp(arg, "--pass-stats=", 13) == 0) {
+                passStats = arg + 13;
+            }
+            else if (strcmp(arg, "--dump-ir") == 0) {
+                dumpIR = true;
+            }
+            else if (strcmp(arg, "--no-superinsts") == 0) {
+                superinsts = false;
+            }
+            else if (strncmp(arg, "--op-profile=", 13) == 0) {
+                opProfile = arg + 13;
+            }
+            else if (strcmp(arg, "--no-quicken") == 0) {
+                quicken = false;
+            }
+            else if (strcmp(arg, "--quicken-stats") == 0) {
+                quickenStats = true;
+            }
+            else if (strcmp(arg, "--jobs") == 0) {
+                jobs = 0;
+            }
+            else if (strncmp(arg, "--jobs=", 7) == 0) {
+                jobs = strtoul(arg + 7, NULL, 10);
+            }
+            else if (strcmp(arg, "--memoize") == 0) {
+                memoize = true;
+            }
+            else if (strncmp(arg, "--memoize=", 10) == 0) {
+                memoize = true;
+                memoCapacity = strtoull(arg + 10, NULL, 10);
+            }
+            else if (strncmp(arg, "--profile=", 10) == 0) {
+                profile = arg + 10;
+            }
+            else if (strncmp(arg, "--profile-hz=", 13) == 0) {
+                profileHz = strtoul(arg + 13, NULL, 10);
+            }
+            else if (strcmp(arg, "--stats") == 0) {
+                stats = "table";
+            }
+            else if (strncmp(arg, "--stats=", 8) == 0) {
+                stats = arg + 8;
+            }
+            else if (strncmp(arg, "--print-to=", 11) == 0) {
+                printTo = arg + 11;
+                if (printTo != "stdout" && printTo != "stderr") {
+                    llvm::errs() << "[ERROR] Unknown Output: " << printTo << "\n";
+                    return false;
+                }
+            }
+            else if (strncmp(arg, "--input=", 8) == 0) {
+                input = arg + 8;
+            }
+            else if (strcmp(arg, "--phase-times") == 0) {
+                phaseTimes = "table";
+            }
+            else if (strncmp(arg, "--phase-times=", 14) == 0) {
+                phaseTimes = arg + 14;
+            }
+            else {
+                llvm::errs() << "[ERROR] Unknown Option: " << arg << "\n";
+                return false;
+            }
+        }
+        if (batch || !inputs.empty()) {
+            if (batch && !inputs.empty()) {
+                llvm::errs() << "[ERROR] --batch And --inputs Cannot Be Used Together\n";
+                return false;
+            }
+            if (!profile.empty() || !phaseTimes.empty() || quickenStats || !opProfile.empty()) {
+                llvm::errs() << "[ERROR] --profile, --phase-times, --quicken-stats And --op-profile Cannot Be Used With --batch Or --inputs\n";
+                return false;
+            }
+            if (jobs == 0) {
+                jobs = std::max(1u, std::thread::hardware_concurrency());
+            }
+#ifdef INTERP_STATS
+            /// The execution counters are process wide and not synchronized
+            if (jobs > 1) {
+                llvm::errs() << "[ERROR] Builds With ENABLE_STATS Need --jobs=1\n";
+                return false;
+            }
+#endif
+        }
+        if ((!saveSnapshot.empty() || !restore.empty()) && (batch || !inputs.empty())) {
+            llvm::errs() << "[ERROR] Snapshots Cannot Be Used With --batch Or --inputs\n";
+            return false;
+        }
+        if (!saveSnapshot.empty() && !restore.empty()) {
+            llvm::errs() << "[ERROR] --save-snapshot And --restore Cannot Be Used Together\n";
+            return false;
+        }
+        if (engine == "simt" && inputs.empty()) {
+            llvm::errs() << "[ERROR] --engine=simt Needs --inputs\n";
+            return false;
+        }
+        if (engine == "ir" && (memoize || !profile.empty() || !saveSnapshot.empty() || !restore.empty())) {
+            llvm::errs() << "[ERROR] --memoize, --profile And Snapshots Need --engine=ast\n";
+            return false;
+        }
+        if (engine != "ast" && (quickenStats || !stats.empty())) {
+            llvm::errs() << "[ERROR] --stats And --quicken-stats Need --engine=ast\n";
+            return false;
+        }
+        if (engine != "ir" && (!passStats.empty() || dumpIR || !opProfile.empty())) {
+            llvm::errs() << "[ERROR] --pass-stats, --dump-ir And --op-profile Need --engine=ir\n";
+            return false;
+        }
+        if (batch) {
+            return !batchPrograms.empty() || !manifest.empty();
+        }
+        if (batchPrograms.size() > 1) {
+            llvm::errs() << "[ERROR] More Than One Program: " << batchPrograms[1] << "\n";
+            return false;
+        }
+        if (!batchPrograms.empty()) {
+            program = batchPrograms[0];
+            batchPrograms.clear();
+        }
+        return !program.empty() || !restore.empty();
+    }
+};
+
+#endif //ASSIGN1_OPTIONS_H
@@ -0,0 +1,86 @@
+//
+// Created by Critizero on 2021/10/22.
+//
+
+#ifndef ASSIGN1_PHASETIMER_H
+#define ASSIGN1_PHASETIMER_H
+
+#include <sys/resource.h>
+#include <time.h>
+#include <string>
+#include <vector>
+
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+/// Wall time, CPU time and peak RSS of the consecutive phases of one run
+class PhaseTimer {
+    struct Phase {
+        std::string name;
+        double wall;
+        double cpu;
+        /// Peak RSS of the process at the end of the phase, in KB
+        long peakRss;
+    };
+
+    std::vector<Phase> mPhases;
+    bool mRunning;
+    double mWallStart;
+    double mCpuStart;
+
+    static double now(clockid_t clock) {
+        struct timespec ts;
+        clock_gettime(clock, &ts);
+        return ts.tv_sec + ts.tv_nsec * 1e-9;
+    }
+    static long peakRss() {
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss;
+    }
+public:
+    PhaseTimer() : mPhases(), mRunning(false), mWallStart(0), mCpuStart(0) {
+    }
+
+    /// End the running phase, if any, and start the next one
+    void begin(const char * name) {
+        end();
+        Phase phase = {name, 0, 0, 0};
+        mPhases.push_back(phase);
+        mRunning = true;
+        mWallStart = now(CLOCK_MONOTONIC);
+        mCpuStart = now(CLOCK_PROCESS_CPUTIME_ID);
+    }
+
+    void end() {
+        if (!mRunning) {
+            return;
+        }
+        Phase & phase = mPhases.back();
+        phase.wall = now(CLOCK_MONOTONIC) - mWallStart;
+        phase.cpu = now(CLOCK_PROCESS_CPUTIME_ID) - mCpuStart;
+        phase.peakRss = peakRss();
+        mRunning = false;
+    }
+
+    void printTable(llvm::raw_ostream & os) {
+        os << "\n[PHASE] phase             wall(ms)     cpu(ms)   peak rss(KB)\n";
+        for (const Phase & phase : mPhases) {
+            os << "[PHASE] " << llvm::format("%-14s %11.3f %11.3f %14ld\n", phase.name.c_str(),
+                                             phase.wall * 1e3, phase.cpu * 1e3, phase.peakRss);
+        }
+    }
+
+    void printJSON(llvm::raw_ostream & os) {
+        os << "{\"phases\": [";
+        for (size_t i = 0; i < mPhases.size(); i++) {
+            const Phase & phase = mPhases[i];
+            os << (i ? ", " : "") << "{\"name\": \"" << phase.name << "\", "
+               << llvm::format("\"wall_ms\": %.3f, \"cpu_ms\": %.3f, ", phase.wall * 1e3, phase.cpu * 1e3)
+               << "\"peak_rss_kb\": " << phase.peakRss << "}";
+        }
+        os << "]}\n";
+    }
+};
+
+#endif //ASSIGN1_PHASETIMER_H
@@ -0,0 +1,144 @@
+//
+// Created by Critizero on 2021/10/22.
+//
+
+#ifndef ASSIGN1_PROFILER_H
+#define ASSIGN1_PROFILER_H
+
+#include <signal.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/time.h>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "clang/AST/Decl.h"
+#include "clang/Basic/SourceManager.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace clang;
+
+/// Number of SIGPROF ticks not yet attributed to a guest stack.
+/// The handler only bumps it, the interpreter polls it where it sets the guest PC.
+static volatile sig_atomic_t gProfileTicks = 0;
+
+static void profileSignalHandler(int) {
+    gProfileTicks = gProfileTicks + 1;
+}
+
+/// One guest frame : the function and the statement it is executing (or calling from)
+typedef std::pair<FunctionDecl *, Stmt *> ProfileFrame;
+
+/// Timer driven sampler of the guest call stack
+class SamplingProfiler {
+    std::map<std::vector<ProfileFrame>, uint64_t> mSamples;
+    uint64_t mTotal;
+    bool mRunning;
+public:
+    SamplingProfiler() : mSamples(), mTotal(0), mRunning(false) {
+    }
+
+    void start(unsigned hz) {
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = profileSignalHandler;
+        action.sa_flags = SA_RESTART;
+        sigaction(SIGPROF, &action, NULL);
+
+        long period = hz ? 1000000 / hz : 1000;
+        if (period == 0) {
+            period = 1;
+        }
+        struct itimerval timer;
+        timer.it_interval.tv_sec = period / 1000000;
+        timer.it_interval.tv_usec = period % 1000000;
+        timer.it_value = timer.it_interval;
+        setitimer(ITIMER_PROF, &timer, NULL);
+        gProfileTicks = 0;
+        mRunning = true;
+    }
+
+    void stop() {
+        if (!mRunning) {
+            return;
+        }
+        struct itimerval timer;
+        memset(&timer, 0, sizeof(timer));
+        setitimer(ITIMER_PROF, &timer, NULL);
+        signal(SIGPROF, SIG_IGN);
+        mRunning = false;
+    }
+
+    /// Attribute the pending ticks to the given stack, outermost frame first
+    void record(const std::vector<ProfileFrame> & stack) {
+        uint64_t ticks = gProfileTicks;
+        gProfileTicks = 0;
+        mSamples[stack] += ticks;
+        mTotal += ticks;
+    }
+
+    static std::string frameName(const ProfileFrame & frame, const SourceManager & sm) {
+        std::string name = frame.first ? frame.first->getNameAsString() : "<global>";
+        if (frame.second) {
+            name += ":" + std::to_string(sm.getSpellingLineNumber(frame.second->getBeginLoc()));
+        }
+        return name;
+    }
+
+    /// Folded stacks ("main:12;foo:7 42"), one line per distinct stack, for flamegraph.pl
+    void writeFolded(llvm::raw_ostream & os, const SourceManager & sm) {
+        for (auto i = mSamples.begin(); i != mSamples.end(); ++ i) {
+            const std::vector<ProfileFrame> & stack = i->first;
+            for (size_t f = 0; f < stack.size(); f++) {
+                os << (f ? ";" : "") << frameName(stack[f], sm);
+            }
+            os << " " << i->second << "\n";
+        }
+    }
+
+    /// Self samples per source line and self / inclusive samples per function
+    void printSummary(llvm::raw_ostream & os, const SourceManager & sm) {
+        std::map<std::string, uint64_t> lines;
+        std::map<std::string, std::pair<uint64_t, uint64_t> > funcs;
+        for (auto i = mSamples.begin(); i != mSamples.end(); ++ i) {
+            const std::vector<ProfileFrame> & stack = i->first;
+            if (stack.empty()) {
+                continue;
+            }
+            lines[frameName(stack.back(), sm)] += i->second;
+            funcs[frameName(ProfileFrame(stack.back().first, NULL), sm)].first += i->second;
+            /// Count recursive functions once per stack
+            std::map<FunctionDecl *, bool> seen;
+            for (size_t f = 0; f < stack.size(); f++) {
+                if (!seen[stack[f].first]) {
+                    seen[stack[f].first] = true;
+                    funcs[frameName(ProfileFrame(stack[f].first, NULL), sm)].second += i->second;
+                }
+            }
+        }
+        os << "\n[PROFILE] " << mTotal << " samples\n";
+        for (auto i = funcs.begin(); i != funcs.end(); ++ i) {
+            os << "[PROFILE] function " << i->first << ": self " << i->second.first
+               << ", total " << i->second.second << "\n";
+        }
+        for (auto i = lines.begin(); i != lines.end(); ++ i) {
+            os << "[PROFILE] line " << i->first << ": " << i->second << "\n";
+        }
+    }
+
+    bool write(const std::string & path, const SourceManager & sm) {
+        std::error_code ec;
+        llvm::raw_fd_ostream os(path, ec, llvm::sys::fs::OF_Text);
+        if (ec) {
+            llvm::errs() << "[ERROR] Cannot Write Profile: " << path << "\n";
+            return false;
+        }
+        writeFolded(os, sm);
+        return true;
+    }
+};
+
+#endif //ASSIGN1_PROFILER_H
@@ -0,0 +1,62 @@
+//
+// Created by Critizero on 2021/10/22.
+//
+
+#ifndef ASSIGN1_PROGRAMINFO_H
+#define ASSIGN1_PROGRAMINFO_H
+
+#include "clang/AST/Decl.h"
+
+#include "DataSegment.h"
+#include "ExprSlots.h"
+#include "Memo.h"
+
+using namespace clang;
+
+/// Everything derived from the AST before a run : the built-in functions, the entry,
+/// the expression slots, the layout of the globals and, with --memoize, the pure functions.
+/// It is only read once analyze() returns, so one instance (and the AST it points into)
+/// can be shared by many Environments running the same program on different threads.
+class ProgramInfo {
+    FunctionDecl * mFree;
+    FunctionDecl * mMalloc;
+    FunctionDecl * mInput;
+    FunctionDecl * mOutput;
+    FunctionDecl * mEntry;
+    ExprSlots mSlots;
+    DataSegment mData;
+    PurityAnalysis mPurity;
+public:
+    ProgramInfo() : mFree(NULL), mMalloc(NULL), mInput(NULL), mOutput(NULL), mEntry(NULL), mSlots(), mData(), mPurity() {
+    }
+    ProgramInfo(const ProgramInfo &) = delete;
+    ProgramInfo & operator=(const ProgramInfo &) = delete;
+
+    void analyze(TranslationUnitDecl * unit, bool memoize, bool ptr32) {
+        for (TranslationUnitDecl::decl_iterator i = unit->decls_begin(), e = unit->decls_end(); i != e; ++ i) {
+            if (FunctionDecl * fdecl = dyn_cast<FunctionDecl>(*i) ) {
+                if (fdecl->getName().equals("FREE")) mFree = fdecl;
+                else if (fdecl->getName().equals("MALLOC")) mMalloc = fdecl;
+                else if (fdecl->getName().equals("GET")) mInput = fdecl;
+                else if (fdecl->getName().equals("PRINT")) mOutput = fdecl;
+                else if (fdecl->getName().equals("main")) mEntry = fdecl;
+            }
+        }
+        mData.analyze(unit, ptr32);
+        mSlots.analyze(unit, mEntry, mData);
+        if (memoize) {
+            mPurity.analyze(unit);
+        }
+    }
+
+    FunctionDecl * getFree() const { return mFree; }
+    FunctionDecl * getMalloc() const { return mMalloc; }
+    FunctionDecl * getInput() const { return mInput; }
+    FunctionDecl * getOutput() const { return mOutput; }
+    FunctionDecl * getEntry() const { return mEntry; }
+    const ExprSlots & getSlots() const { return mSlots; }
+    const DataSegment & getData() const { return mData; }
+    const PurityAnalysis & getPurity() const { return mPurity; }
+};
+
+#endif //ASSIGN1_PROGRAMINFO_H
@@ -0,0 +1,71 @@
+//
+// Created by Critizero on 2021/10/22.
+//
+
+#ifndef ASSIGN1_QUICKEN_H
+#define ASSIGN1_QUICKEN_H
+
+#include <stdint.h>
+
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+/// Specialized forms an expression node of the AST engine takes after its first execution.
+/// The generic paths of the Environment derive from the clang types, on every run, whether an
+/// addition scales a pointer, how wide and how signed a value in guest memory is and where an
+/// array lives. A quickened node keeps what its first run found and goes straight to it.
+/// The type of a node never changes, so most forms hold for good. A local array is at another
+/// address in every frame, so its form remembers the frame it was found in and is guarded by it.
+enum QuickKind : uint8_t {
+    /// Not run yet, the next run takes the generic path and quickens the node
+    QK_None,
+    /// Binary operators, width is the pointee width of pointer arithmetic
+    QK_Add,
+    QK_Sub,
+    QK_AddPtr,
+    QK_SubPtr,
+    QK_Mul,
+    QK_Div,
+    QK_Lt,
+    QK_Gt,
+    QK_Eq,
+    /// A reference to a global : base is its address, the value of a global array
+    QK_GlobalScalar,
+    QK_GlobalArray,
+    /// An element of a global array or of a local array of the frame, base is the array
+    QK_ElemGlobal,
+    QK_ElemLocal,
+    /// *p
+    QK_Deref
+};
+
+/// The quickened state of one expression node, indexed by its ExprSlots id
+struct QuickOp {
+    QuickKind kind;
+    /// Of the value read or written
+    bool isSigned;
+    int32_t width;
+    int64_t base;
+    /// Serial of the frame base was found in, for QK_ElemLocal
+    uint64_t frame;
+};
+
+/// How many of the operations that quicken ran in quickened form, for --quicken-stats
+struct QuickenStats {
+    uint64_t quick;
+    uint64_t generic;
+    /// Quickened runs whose guard failed, they took the generic path and quickened again
+    uint64_t guardFailures;
+
+    QuickenStats() : quick(0), generic(0), guardFailures(0) {
+    }
+
+    void print(llvm::raw_ostream & os) const {
+        uint64_t total = quick + generic;
+        os << "\n[QUICKEN] " << quick << " of " << total << " operations ran quickened ("
+           << llvm::format("%.1f", total ? 100.0 * quick / total : 0.0) << "%), "
+           << guardFailures << " guard failures\n";
+    }
+};
+
+#endif //ASSIGN1_QUICKEN_H
@@ -0,0 +1,117 @@
+//
+// Created by Critizero on 2021/10/22.
+//
+
+#ifndef ASSIGN1_SNAPSHOT_H
+#define ASSIGN1_SNAPSHOT_H
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+/// Interpreter state right after Environment::init, saved next to the serialized AST.
+/// main is named by its position among the translation unit's decls, which is the same in the
+/// parsed and in the deserialized AST. Guest addresses are offsets into the guest memory, so the
+/// globals segment and the heap blocks are restored at the same addresses.
+struct SnapshotState {
+    struct Block {
+        int64_t addr;
+        std::string bytes;
+    };
+
+    /// Position of main
+    uint32_t entry;
+    /// Bytes of a pointer in guest memory, a snapshot only fits the same --ptr32 setting
+    uint32_t pointerWidth;
+    /// The globals segment
+    std::string data;
+    std::vector<Block> heap;
+
+    SnapshotState() : entry(0), pointerWidth(8), data(), heap() {
+    }
+
+    bool write(const std::string & path) const {
+        std::error_code ec;
+        llvm::raw_fd_ostream os(path, ec);
+        if (ec) {
+            return false;
+        }
+        os.write(magic(), kMagicSize);
+        put(os, entry);
+        put(os, pointerWidth);
+        put(os, (uint64_t)data.size());
+        os.write(data.data(), data.size());
+        put(os, (uint64_t)heap.size());
+        for (const Block & block : heap) {
+            put(os, block.addr);
+            put(os, (uint64_t)block.bytes.size());
+            os.write(block.bytes.data(), block.bytes.size());
+        }
+        return !os.has_error();
+    }
+
+    /// Return false if path cannot be read or is not a snapshot of this version
+    bool read(const std::string & path) {
+        llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer> > buffer = llvm::MemoryBuffer::getFile(path);
+        if (!buffer) {
+            return false;
+        }
+        const char * p = (*buffer)->getBufferStart();
+        const char * end = (*buffer)->getBufferEnd();
+        if ((size_t)(end - p) < kMagicSize || memcmp(p, magic(), kMagicSize) != 0) {
+            return false;
+        }
+        p += kMagicSize;
+        uint64_t count;
+        if (!get(p, end, entry) || !get(p, end, pointerWidth) || !get(p, end, count) || count > (uint64_t)(end - p)) {
+            return false;
+        }
+        data.assign(p, count);
+        p += count;
+        if (!get(p, end, count) || count > (uint64_t)(end - p)) {
+            return false;
+        }
+        heap.resize(count);
+        for (Block & block : heap) {
+            uint64_t size;
+            if (!get(p, end, block.addr) || !get(p, end, size) || (uint64_t)(end - p) < size) {
+                return false;
+            }
+            block.bytes.assign(p, size);
+            p += size;
+        }
+        return p == end;
+    }
+
+    /// The serialized AST that goes with the snapshot at path
+    static std::string astPath(const std::string & path) {
+        return path + ".ast";
+    }
+private:
+    static const size_t kMagicSize = 8;
+
+    static const char * magic() {
+        return "MINICSN4";
+    }
+
+    template <typename T>
+    static void put(llvm::raw_ostream & os, T value) {
+        os.write((const char *)&value, sizeof(value));
+    }
+
+    template <typename T>
+    static bool get(const char * & p, const char * end, T & value) {
+        if ((size_t)(end - p) < sizeof(value)) {
+            return false;
+        }
+        memcpy(&value, p, sizeof(value));
+        p += sizeof(value);
+        return true;
+    }
+};
+
+#endif //ASSIGN1_SNAPSHOT_H
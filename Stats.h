@@ -0,0 +1,171 @@
+//
+// Created by Critizero on 2021/10/22.
+//
+
+#ifndef ASSIGN1_STATS_H
+#define ASSIGN1_STATS_H
+
+/// Execution counters for --stats.
+/// Only built with -DINTERP_STATS (cmake -DENABLE_STATS=ON), otherwise every
+/// STATS_* macro expands to nothing and the interpreter carries no counters.
+
+#ifdef INTERP_STATS
+
+#include <stdint.h>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "clang/AST/Decl.h"
+#include "clang/AST/Stmt.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/FormatAdapters.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace clang;
+
+class ExecStats {
+    struct StmtCounter {
+        const char * name;
+        uint64_t visited;
+        uint64_t calculated;
+    };
+    struct FuncCounter {
+        uint64_t calls;
+        uint64_t executed;
+        /// Activations on the guest stack, time is only taken for the outermost one
+        uint64_t active;
+        std::chrono::steady_clock::time_point start;
+        std::chrono::steady_clock::duration inclusive;
+    };
+
+    StmtCounter mStmts[Stmt::lastStmtConstant + 1];
+    std::map<FunctionDecl *, FuncCounter> mFuncs;
+    std::vector<FunctionDecl *> mCalls;
+    uint64_t mMallocs;
+    uint64_t mMallocBytes;
+    uint64_t mFrees;
+    size_t mPeakDepth;
+
+    ExecStats() : mStmts(), mFuncs(), mCalls(), mMallocs(0), mMallocBytes(0), mFrees(0), mPeakDepth(0) {
+    }
+public:
+    static ExecStats & get() {
+        static ExecStats stats;
+        return stats;
+    }
+
+    void visit(Stmt * stmt) {
+        StmtCounter & counter = mStmts[stmt->getStmtClass()];
+        counter.name = stmt->getStmtClassName();
+        counter.visited++;
+    }
+    void calculate(Stmt * stmt) {
+        StmtCounter & counter = mStmts[stmt->getStmtClass()];
+        counter.name = stmt->getStmtClassName();
+        counter.calculated++;
+    }
+
+    /// A call of a guest function, executed is false when its result came from the cache
+    void call(FunctionDecl * func, bool executed) {
+        FuncCounter & counter = mFuncs[func->getCanonicalDecl()];
+        counter.calls++;
+        if (!executed) {
+            return;
+        }
+        counter.executed++;
+        if (counter.active++ == 0) {
+            counter.start = std::chrono::steady_clock::now();
+        }
+        mCalls.push_back(func->getCanonicalDecl());
+    }
+    void ret() {
+        FuncCounter & counter = mFuncs[mCalls.back()];
+        mCalls.pop_back();
+        if (--counter.active == 0) {
+            counter.inclusive += std::chrono::steady_clock::now() - counter.start;
+        }
+    }
+    void depth(size_t depth) {
+        if (depth > mPeakDepth) {
+            mPeakDepth = depth;
+        }
+    }
+    void malloced(int64_t size) {
+        mMallocs++;
+        mMallocBytes += size;
+    }
+    void freed() {
+        mFrees++;
+    }
+
+    static double micros(std::chrono::steady_clock::duration d) {
+        return std::chrono::duration<double, std::micro>(d).count();
+    }
+
+    void printTable(llvm::raw_ostream & os) {
+        os << "\n[STATS] statement class            visited   calculated\n";
+        for (const StmtCounter & counter : mStmts) {
+            if (counter.name) {
+                os << "[STATS] " << llvm::left_justify(counter.name, 24)
+                   << llvm::format_decimal(counter.visited, 12) << " "
+                   << llvm::format_decimal(counter.calculated, 12) << "\n";
+            }
+        }
+        os << "[STATS] function                   calls     executed   inclusive(us)\n";
+        for (auto i = mFuncs.begin(); i != mFuncs.end(); ++ i) {
+            os << "[STATS] " << llvm::left_justify(i->first->getName(), 24)
+               << llvm::format_decimal(i->second.calls, 12) << " "
+               << llvm::format_decimal(i->second.executed, 12) << " "
+               << llvm::format("%15.1f", micros(i->second.inclusive)) << "\n";
+        }
+        os << "[STATS] heap: " << mMallocs << " mallocs, " << mMallocBytes << " bytes, "
+           << mFrees << " frees\n";
+        os << "[STATS] peak stack depth: " << mPeakDepth << "\n";
+    }
+
+    void printJSON(llvm::raw_ostream & os) {
+        os << "{\"stmts\": {";
+        bool first = true;
+        for (const StmtCounter & counter : mStmts) {
+            if (counter.name) {
+                os << (first ? "" : ", ") << "\"" << counter.name << "\": {\"visited\": "
+                   << counter.visited << ", \"calculated\": " << counter.calculated << "}";
+                first = false;
+            }
+        }
+        os << "}, \"functions\": {";
+        first = true;
+        for (auto i = mFuncs.begin(); i != mFuncs.end(); ++ i) {
+            os << (first ? "" : ", ") << "\"" << i->first->getName() << "\": {\"calls\": "
+               << i->second.calls << ", \"executed\": " << i->second.executed
+               << ", \"inclusive_us\": " << llvm::format("%.1f", micros(i->second.inclusive)) << "}";
+            first = false;
+        }
+        os << "}, \"heap\": {\"mallocs\": " << mMallocs << ", \"bytes\": " << mMallocBytes
+           << ", \"frees\": " << mFrees << "}, \"peak_stack_depth\": " << mPeakDepth << "}\n";
+    }
+};
+
+#define STATS_VISIT(stmt) ExecStats::get().visit(stmt)
+#define STATS_CALCULATE(stmt) ExecStats::get().calculate(stmt)
+#define STATS_CALL(func, executed) ExecStats::get().call(func, executed)
+#define STATS_RETURN() ExecStats::get().ret()
+#define STATS_DEPTH(n) ExecStats::get().depth(n)
+#define STATS_MALLOC(size) ExecStats::get().malloced(size)
+#define STATS_FREE() ExecStats::get().freed()
+
+#else
+
+#define STATS_VISIT(stmt)
+#define STATS_CALCULATE(stmt)
+#define STATS_CALL(func, executed)
+#define STATS_RETURN()
+#define STATS_DEPTH(n)
+#define STATS_MALLOC(size)
+#define STATS_FREE()
+
+#endif
+
+#endif //ASSIGN1_STATS_H
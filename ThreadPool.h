@@ -0,0 +1,95 @@
+//
+// Created by Critizero on 2021/10/22.
+//
+
+#ifndef ASSIGN1_THREADPOOL_H
+#define ASSIGN1_THREADPOOL_H
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Work-stealing pool for independent tasks.
+/// Each worker has its own deque; it takes tasks from the back of its own deque and,
+/// once that is empty, steals from the front of the others, so one long task does not
+/// leave the remaining workers idle. All tasks are submitted before run(), which makes
+/// the calling thread worker 0 and returns when every task has finished.
+class WorkStealingPool {
+public:
+    /// The argument is the index of the worker running the task, for per-worker state
+    typedef std::function<void(unsigned)> Task;
+private:
+    struct Queue {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue> > mQueues;
+    unsigned mNext;
+
+    bool popOwn(unsigned worker, Task & task) {
+        Queue & queue = *mQueues[worker];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (queue.tasks.empty()) {
+            return false;
+        }
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        return true;
+    }
+
+    bool steal(unsigned worker, Task & task) {
+        for (unsigned i = 1; i < mQueues.size(); i++) {
+            Queue & queue = *mQueues[(worker + i) % mQueues.size()];
+            std::lock_guard<std::mutex> guard(queue.lock);
+            if (!queue.tasks.empty()) {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// No task is submitted while running, so a worker that finds every deque empty is done
+    void work(unsigned worker) {
+        Task task;
+        while (popOwn(worker, task) || steal(worker, task)) {
+            task(worker);
+        }
+    }
+public:
+    explicit WorkStealingPool(unsigned workers) : mQueues(), mNext(0) {
+        for (unsigned i = 0; i < (workers ? workers : 1); i++) {
+            mQueues.emplace_back(new Queue());
+        }
+    }
+
+    unsigned size() const {
+        return mQueues.size();
+    }
+
+    /// Tasks are dealt round robin, the first ones submitted run first
+    void submit(Task task) {
+        Queue & queue = *mQueues[mNext];
+        mNext = (mNext + 1) % mQueues.size();
+        std::lock_guard<std::mutex> guard(queue.lock);
+        queue.tasks.push_front(std::move(task));
+    }
+
+    void run() {
+        std::vector<std::thread> threads;
+        for (unsigned i = 1; i < mQueues.size(); i++) {
+            threads.emplace_back(&WorkStealingPool::work, this, i);
+        }
+        work(0);
+        for (std::thread & thread : threads) {
+            thread.join();
+        }
+    }
+};
+
+#endif //ASSIGN1_THREADPOOL_H
@@ -0,0 +1,606 @@
+//
+// Created by Critizero on 2021/10/22.
+//
+
+#ifndef ASSIGN1_VECTORENGINE_H
+#define ASSIGN1_VECTORENGINE_H
+
+#include <stdint.h>
+#include <string.h>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "clang/AST/Decl.h"
+#include "clang/AST/Expr.h"
+#include "clang/AST/Stmt.h"
+#include "llvm/ADT/DenseMap.h"
+
+#include "Batch.h"
+#include "DataSegment.h"
+#include "Environment.h"
+#include "GuestIO.h"
+#include "GuestMemory.h"
+#include "ProgramInfo.h"
+
+using namespace clang;
+
+/// Lockstep (SIMT) execution of one program over K inputs at once.
+/// Every guest value is K lanes of int64_t, one per input, and each AST node is dispatched
+/// once for all lanes; the per-lane work is plain loops over contiguous lanes, which the
+/// compiler turns into SIMD. Divergent control flow runs under lane masks : an if runs both
+/// arms with complementary masks, a loop keeps iterating while any lane is still in it and
+/// a return retires its lanes from the rest of the function.
+/// Every lane has its own globals, arrays and MALLOC blocks, allocated per lane in one guest
+/// memory shared by the group, so a pointer lane always points into storage of that lane.
+/// PRINT and GET use the lane's job.
+/// Unlike the scalar Environment, calls are evaluated wherever they appear in an expression.
+class VectorEngine {
+    typedef std::vector<char> Mask;
+
+    struct Frame {
+        /// Offset of each variable's lanes in mValues
+        llvm::DenseMap<const Decl *, unsigned> mVars;
+        std::vector<int64_t> mValues;
+        /// Lanes of the expression temporaries, by ExprSlots numbering
+        std::vector<int64_t> mExprs;
+        /// Top of the guest stack when the frame was pushed
+        int64_t mStackMark;
+        std::vector<int64_t> mRet;
+        /// Lanes that executed a return
+        Mask mReturned;
+
+        Frame(unsigned slots, unsigned lanes, int64_t stackMark) : mVars(), mValues(), mExprs(slots * lanes, 0),
+                mStackMark(stackMark), mRet(lanes, 0), mReturned(lanes, 0) {
+        }
+    };
+
+    const ProgramInfo & mInfo;
+    unsigned mLanes;
+    std::vector<BatchJob *> mJobs;
+    /// A deque, so frames never move and lane pointers into them stay valid across calls
+    std::deque<Frame> mStack;
+    llvm::DenseMap<const Decl *, unsigned> mGlobalVars;
+    std::vector<int64_t> mGlobals;
+    /// Segment offset of each scalar global. They live in every lane's copy of the data segment
+    /// and are loaded and stored at the width of their type, like in the scalar Environment
+    llvm::DenseMap<const Decl *, int64_t> mScalarGlobals;
+    /// Bytes of the data segment image, the distance between the copies of two lanes
+    int64_t mImageSize;
+    /// Lanes of an address, for the scalar globals
+    std::vector<int64_t> mAddr;
+    GuestMemory mMemory;
+    Heap mHeap;
+    std::vector<std::unique_ptr<OutputBuffer> > mOut;
+    std::vector<std::unique_ptr<InputReader> > mIn;
+    /// Lanes stopped by a runtime error
+    Mask mDead;
+
+    bool any(const Mask & mask) const {
+        for (unsigned k = 0; k < mLanes; k++) {
+            if (mask[k]) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// Drop the lanes that returned from the current function or failed
+    void retire(Mask & mask) {
+        const Mask & returned = mStack.back().mReturned;
+        for (unsigned k = 0; k < mLanes; k++) {
+            mask[k] = mask[k] && !returned[k] && !mDead[k];
+        }
+    }
+
+    /// A runtime error stops only the lane it happened in
+    void laneError(unsigned k, const char * msg) {
+        if (mDead[k]) {
+            return;
+        }
+        mDead[k] = 1;
+        mOut[k]->flush();
+        mJobs[k]->status = "error";
+        mJobs[k]->error = msg;
+    }
+
+    int64_t * slot(Expr * expr) {
+        return &mStack.back().mExprs[mInfo.getSlots().slot(expr) * mLanes];
+    }
+
+    int64_t * var(const Decl * decl) {
+        Frame & frame = mStack.back();
+        auto it = frame.mVars.find(decl);
+        if (it != frame.mVars.end()) {
+            return &frame.mValues[it->second];
+        }
+        auto global = mGlobalVars.find(decl);
+        if (global != mGlobalVars.end()) {
+            return &mGlobals[global->second];
+        }
+        return bindVar(decl);
+    }
+
+    /// Lanes of the address of decl if it is a scalar global, NULL otherwise
+    int64_t * scalarGlobal(const Decl * decl) {
+        auto it = mScalarGlobals.find(decl);
+        if (it == mScalarGlobals.end()) {
+            return NULL;
+        }
+        for (unsigned k = 0; k < mLanes; k++) {
+            mAddr[k] = mMemory.globalsBegin() + k * mImageSize + it->second;
+        }
+        return mAddr.data();
+    }
+
+    int64_t * bindVar(const Decl * decl) {
+        Frame & frame = mStack.back();
+        auto it = frame.mVars.find(decl);
+        if (it != frame.mVars.end()) {
+            return &frame.mValues[it->second];
+        }
+        unsigned offset = frame.mValues.size();
+        frame.mValues.resize(offset + mLanes, 0);
+        frame.mVars[decl] = offset;
+        return &frame.mValues[offset];
+    }
+
+    static void blend(int64_t * dst, const int64_t * src, const Mask & mask, unsigned lanes) {
+        for (unsigned k = 0; k < lanes; k++) {
+            dst[k] = mask[k] ? src[k] : dst[k];
+        }
+    }
+
+    /// Load a value of type at the address of each lane in mask, a bad address stops only its lane
+    void load(const int64_t * addr, const Type * type, const Mask & mask, int64_t * out) {
+        int64_t width = mMemory.width(type);
+        bool sign = type->isSignedIntegerType();
+        for (unsigned k = 0; k < mLanes; k++) {
+            out[k] = 0;
+            if (mask[k] && !mDead[k] && !mMemory.load(addr[k], width, sign, out[k])) {
+                laneError(k, "[ERROR] Invalid Memory Access");
+            }
+        }
+    }
+
+    void fill(int64_t * out, int64_t value) {
+        for (unsigned k = 0; k < mLanes; k++) {
+            out[k] = value;
+        }
+    }
+
+    void declare(DeclStmt * decl_stmt, const Mask & mask) {
+        for (DeclStmt::decl_iterator it = decl_stmt->decl_begin(), ie = decl_stmt->decl_end(); it != ie; ++ it) {
+            VarDecl * var_decl = dyn_cast<VarDecl>(*it);
+            if (!var_decl) {
+                continue;
+            }
+            const Type * type = var_decl->getType().getTypePtr();
+            if (auto array = dyn_cast<ConstantArrayType>(type)) {
+                /// Elements are as wide as their C type, like in the scalar Environment. Only the lanes
+                /// that run the declaration get storage, so a lane recursing deeper than the others
+                /// uses the guest stack alone, and an overflow stops only that lane
+                int64_t bytes = array->getSize().getSExtValue() * mMemory.width(array->getElementType().getTypePtr());
+                int64_t * lanes = bindVar(var_decl);
+                for (unsigned k = 0; k < mLanes; k++) {
+                    if (!mask[k] || mDead[k]) {
+                        continue;
+                    }
+                    if (lanes[k]) {
+                        memset(mMemory.at(lanes[k], bytes), 0, bytes);
+                    }
+                    else if (!(lanes[k] = mMemory.pushStack(bytes))) {
+                        laneError(k, "[ERROR] Guest Stack Overflow");
+                    }
+                }
+            }
+            else if (var_decl->hasInit()) {
+                int64_t * value = eval(var_decl->getInit(), mask);
+                blend(bindVar(var_decl), value, mask, mLanes);
+            }
+            else {
+                int64_t * lanes = bindVar(var_decl);
+                for (unsigned k = 0; k < mLanes; k++) {
+                    lanes[k] = mask[k] ? 0 : lanes[k];
+                }
+            }
+        }
+    }
+
+    void assign(BinaryOperator * bop, const Mask & mask, int64_t * out) {
+        Expr * left = bop->getLHS()->IgnoreParens();
+        int64_t * value = eval(bop->getRHS(), mask);
+        memcpy(out, value, mLanes * sizeof(int64_t));
+        int64_t * addr;
+        if (DeclRefExpr * declexpr = dyn_cast<DeclRefExpr>(left)) {
+            addr = scalarGlobal(declexpr->getDecl());
+            if (!addr) {
+                blend(var(declexpr->getDecl()), out, mask, mLanes);
+                return;
+            }
+        }
+        else if (auto array = dyn_cast<ArraySubscriptExpr>(left)) {
+            addr = elementAddr(array, mask);
+        }
+        else if (auto uop = dyn_cast<UnaryOperator>(left)) {
+            if (uop->getOpcode() != UO_Deref) {
+                throw InterpreterError("[ERROR] Unknown Operator");
+            }
+            addr = eval(uop->getSubExpr(), mask);
+        }
+        else {
+            throw InterpreterError("[ERROR] Unknown Expr");
+        }
+        int64_t width = mMemory.width(left->getType().getTypePtr());
+        for (unsigned k = 0; k < mLanes; k++) {
+            if (mask[k] && !mDead[k] && !mMemory.store(addr[k], width, out[k])) {
+                laneError(k, "[ERROR] Invalid Memory Access");
+            }
+        }
+    }
+
+    /// Lanes of the address of array[idx], kept in the slot of the subscript
+    int64_t * elementAddr(ArraySubscriptExpr * array, const Mask & mask) {
+        int64_t * base = eval(array->getBase(), mask);
+        int64_t * idx = eval(array->getIdx(), mask);
+        int64_t * out = slot(array);
+        int64_t width = mMemory.width(array->getType().getTypePtr());
+        for (unsigned k = 0; k < mLanes; k++) {
+            out[k] = base[k] + idx[k] * width;
+        }
+        return out;
+    }
+
+    void binop(BinaryOperator * bop, const Mask & mask, int64_t * out) {
+        if (bop->getOpcode() == BO_Assign) {
+            assign(bop, mask, out);
+            return;
+        }
+        Expr * left = bop->getLHS();
+        int64_t * l = eval(left, mask);
+        int64_t * r = eval(bop->getRHS(), mask);
+        int64_t scale = left->getType().getTypePtr()->isPointerType() ?
+                        mMemory.width(left->getType()->getPointeeType().getTypePtr()) : 1;
+        switch (bop->getOpcode()) {
+            case BO_Add:
+                for (unsigned k = 0; k < mLanes; k++) out[k] = l[k] + scale * r[k];
+                break;
+            case BO_Sub:
+                for (unsigned k = 0; k < mLanes; k++) out[k] = l[k] - scale * r[k];
+                break;
+            case BO_Mul:
+                for (unsigned k = 0; k < mLanes; k++) out[k] = l[k] * r[k];
+                break;
+            case BO_Div:
+                for (unsigned k = 0; k < mLanes; k++) {
+                    if (mask[k] && r[k] == 0) {
+                        laneError(k, "[ERROR] Dived By Zero");
+                    }
+                }
+                for (unsigned k = 0; k < mLanes; k++) out[k] = r[k] ? l[k] / r[k] : 0;
+                break;
+            case BO_LT:
+                for (unsigned k = 0; k < mLanes; k++) out[k] = l[k] < r[k];
+                break;
+            case BO_GT:
+                for (unsigned k = 0; k < mLanes; k++) out[k] = l[k] > r[k];
+                break;
+            case BO_EQ:
+                for (unsigned k = 0; k < mLanes; k++) out[k] = l[k] == r[k];
+                break;
+            default:
+                throw InterpreterError("[ERROR] Unknown Operator");
+        }
+    }
+
+    void unaryop(UnaryOperator * uop, const Mask & mask, int64_t * out) {
+        int64_t * value = eval(uop->getSubExpr(), mask);
+        switch (uop->getOpcode()) {
+            case UO_Minus:
+                for (unsigned k = 0; k < mLanes; k++) out[k] = -value[k];
+                break;
+            case UO_Plus:
+                memcpy(out, value, mLanes * sizeof(int64_t));
+                break;
+            case UO_Deref:
+                load(value, uop->getType().getTypePtr(), mask, out);
+                break;
+            default:
+                throw InterpreterError("[ERROR] Unknown Operator");
+        }
+    }
+
+    void call(CallExpr * call_expr, const Mask & mask, int64_t * out) {
+        FunctionDecl * callee = call_expr->getDirectCallee();
+        if (!callee) {
+            throw InterpreterError("[ERROR] Unknown Expr");
+        }
+        if (callee == mInfo.getInput()) {
+            for (unsigned k = 0; k < mLanes; k++) {
+                int64_t val = 0;
+                if (mask[k] && !mDead[k]) {
+                    mIn[k]->readInt(val);
+                }
+                out[k] = val;
+            }
+        }
+        else if (callee == mInfo.getOutput()) {
+            int64_t * value = eval(call_expr->getArg(0), mask);
+            for (unsigned k = 0; k < mLanes; k++) {
+                if (mask[k] && !mDead[k]) {
+                    mOut[k]->writeInt(value[k]);
+                }
+            }
+        }
+        else if (callee == mInfo.getMalloc()) {
+            int64_t * size = eval(call_expr->getArg(0), mask);
+            for (unsigned k = 0; k < mLanes; k++) {
+                out[k] = mask[k] && !mDead[k] ? mHeap.Malloc(size[k]) : 0;
+                if (mask[k] && !mDead[k] && !out[k]) {
+                    laneError(k, "[ERROR] Out Of Guest Memory");
+                }
+            }
+        }
+        else if (callee == mInfo.getFree()) {
+            int64_t * addr = eval(call_expr->getArg(0), mask);
+            for (unsigned k = 0; k < mLanes; k++) {
+                if (mask[k] && !mDead[k] && !mHeap.Free(addr[k])) {
+                    laneError(k, "[ERROR] Not A Valid Address");
+                }
+            }
+        }
+        else {
+            std::vector<int64_t *> args;
+            for (auto b = call_expr->arg_begin(), e = call_expr->arg_end(); b != e; b++) {
+                args.push_back(eval(*b, mask));
+            }
+            const FunctionDecl * definition = NULL;
+            Stmt * body_stmt = callee->getBody(definition);
+            if (!body_stmt) {
+                throw InterpreterError("[ERROR] Unknown Function");
+            }
+            mStack.emplace_back(mInfo.getSlots().size(callee), mLanes, mMemory.stackTop());
+            unsigned idx = 0;
+            for (auto i = definition->param_begin(), j = definition->param_end(); i != j; i++) {
+                memcpy(bindVar(*i), args[idx++], mLanes * sizeof(int64_t));
+            }
+            Mask body(mask);
+            retire(body);
+            exec(body_stmt, body);
+            std::vector<int64_t> ret(std::move(mStack.back().mRet));
+            mMemory.popStack(mStack.back().mStackMark);
+            mStack.pop_back();
+            memcpy(out, ret.data(), mLanes * sizeof(int64_t));
+        }
+    }
+
+    /// Lanes of expr, only the lanes in mask are meaningful
+    int64_t * eval(Expr * expr, const Mask & mask) {
+        expr = expr->IgnoreImpCasts();
+        if (auto exp = dyn_cast<ParenExpr>(expr)) {
+            return eval(exp->getSubExpr(), mask);
+        }
+        if (auto exp = dyn_cast<CStyleCastExpr>(expr)) {
+            return eval(exp->getSubExpr(), mask);
+        }
+        int64_t * out = slot(expr);
+        if (auto exp = dyn_cast<IntegerLiteral>(expr)) {
+            fill(out, exp->getValue().getSExtValue());
+        }
+        else if (auto exp = dyn_cast<CharacterLiteral>(expr)) {
+            fill(out, exp->getValue());
+        }
+        else if (auto exp = dyn_cast<DeclRefExpr>(expr)) {
+            if (int64_t * addr = scalarGlobal(exp->getDecl())) {
+                load(addr, exp->getType().getTypePtr(), mask, out);
+            }
+            else {
+                memcpy(out, var(exp->getDecl()), mLanes * sizeof(int64_t));
+            }
+        }
+        else if (auto exp = dyn_cast<BinaryOperator>(expr)) {
+            binop(exp, mask, out);
+        }
+        else if (auto exp = dyn_cast<UnaryOperator>(expr)) {
+            unaryop(exp, mask, out);
+        }
+        else if (auto exp = dyn_cast<ArraySubscriptExpr>(expr)) {
+            load(elementAddr(exp, mask), exp->getType().getTypePtr(), mask, out);
+        }
+        else if (auto exp = dyn_cast<CallExpr>(expr)) {
+            call(exp, mask, out);
+        }
+        else if (auto exp = dyn_cast<UnaryExprOrTypeTraitExpr>(expr)) {
+            int64_t size = 0;
+            if (exp->getKind() == UETT_SizeOf) {
+                if (exp->getArgumentType()->isIntegerType() || exp->getArgumentType()->isPointerType()) {
+                    size = mMemory.width(exp->getArgumentType().getTypePtr());
+                }
+            }
+            fill(out, size);
+        }
+        else {
+            throw InterpreterError("[ERROR] Unknown Expr");
+        }
+        return out;
+    }
+
+    /// Execute stmt for the lanes in mask, lanes that return are dropped from mask
+    void exec(Stmt * stmt, Mask & mask) {
+        if (!any(mask)) {
+            return;
+        }
+        if (auto compound = dyn_cast<CompoundStmt>(stmt)) {
+            for (Stmt * child : compound->body()) {
+                exec(child, mask);
+                if (!any(mask)) {
+                    return;
+                }
+            }
+        }
+        else if (auto decl_stmt = dyn_cast<DeclStmt>(stmt)) {
+            declare(decl_stmt, mask);
+        }
+        else if (auto if_stmt = dyn_cast<IfStmt>(stmt)) {
+            int64_t * cond = eval(if_stmt->getCond(), mask);
+            Mask then_mask(mLanes), else_mask(mLanes);
+            for (unsigned k = 0; k < mLanes; k++) {
+                then_mask[k] = mask[k] && cond[k] != 0;
+                else_mask[k] = mask[k] && cond[k] == 0;
+            }
+            exec(if_stmt->getThen(), then_mask);
+            if (Stmt * else_stmt = if_stmt->getElse()) {
+                exec(else_stmt, else_mask);
+            }
+        }
+        else if (auto while_stmt = dyn_cast<WhileStmt>(stmt)) {
+            Mask loop(mask);
+            for (;;) {
+                int64_t * cond = eval(while_stmt->getCond(), loop);
+                for (unsigned k = 0; k < mLanes; k++) {
+                    loop[k] = loop[k] && cond[k] != 0;
+                }
+                retire(loop);
+                if (!any(loop)) {
+                    break;
+                }
+                exec(while_stmt->getBody(), loop);
+                retire(loop);
+            }
+        }
+        else if (auto for_stmt = dyn_cast<ForStmt>(stmt)) {
+            if (Stmt * init = for_stmt->getInit()) {
+                exec(init, mask);
+            }
+            Mask loop(mask);
+            for (;;) {
+                if (Expr * cond_expr = for_stmt->getCond()) {
+                    int64_t * cond = eval(cond_expr, loop);
+                    for (unsigned k = 0; k < mLanes; k++) {
+                        loop[k] = loop[k] && cond[k] != 0;
+                    }
+                }
+                retire(loop);
+                if (!any(loop)) {
+                    break;
+                }
+                exec(for_stmt->getBody(), loop);
+                retire(loop);
+                if (Expr * inc = for_stmt->getInc()) {
+                    eval(inc, loop);
+                }
+            }
+        }
+        else if (auto return_stmt = dyn_cast<ReturnStmt>(stmt)) {
+            Frame & frame = mStack.back();
+            int64_t * value = NULL;
+            if (Expr * ret = return_stmt->getRetValue()) {
+                value = eval(ret, mask);
+            }
+            for (unsigned k = 0; k < mLanes; k++) {
+                if (mask[k]) {
+                    frame.mRet[k] = value ? value[k] : 0;
+                    frame.mReturned[k] = 1;
+                }
+            }
+        }
+        else if (isa<NullStmt>(stmt)) {
+        }
+        else if (Expr * expr = dyn_cast<Expr>(stmt)) {
+            eval(expr, mask);
+        }
+        else {
+            throw InterpreterError("[ERROR] Unknown Stmt");
+        }
+        retire(mask);
+    }
+public:
+    /// Run the program for each job at once, one lane per job
+    VectorEngine(const ProgramInfo & info, const std::vector<BatchJob *> & jobs, bool ptr32)
+            : mInfo(info), mLanes(jobs.size()), mJobs(jobs), mStack(), mGlobalVars(), mGlobals(),
+              mScalarGlobals(), mImageSize(0), mAddr(jobs.size(), 0),
+              mMemory(ptr32), mHeap(mMemory), mOut(), mIn(), mDead(jobs.size(), 0) {
+        for (BatchJob * job : jobs) {
+            mOut.emplace_back(new OutputBuffer(-1, &job->output));
+            mIn.emplace_back(new InputReader());
+        }
+    }
+
+    /// Initialize the globals and run main in every lane, the outcome goes to the jobs
+    void run(TranslationUnitDecl * unit) {
+        for (unsigned k = 0; k < mLanes; k++) {
+            if (mJobs[k]->input.empty()) {
+                mIn[k]->openEmpty();
+            }
+            else if (!mIn[k]->open(mJobs[k]->input)) {
+                laneError(k, "[ERROR] Cannot Read Input");
+            }
+        }
+        FunctionDecl * entry = mInfo.getEntry();
+        try {
+            /// Global initializers are numbered in the slots of main
+            mStack.emplace_back(mInfo.getSlots().size(entry), mLanes, mMemory.stackTop());
+            Mask all(mLanes, 1);
+            retire(all);
+            /// Every lane gets its own copy of the data segment image, lane k's at k * image size, so
+            /// globals are per lane like the locals. Only the globals outside the segment keep their lanes in mGlobals
+            const DataSegment & data = mInfo.getData();
+            mImageSize = data.image().size();
+            if (!mMemory.loadGlobals(data.image(), mLanes)) {
+                throw InterpreterError("[ERROR] Out Of Guest Memory");
+            }
+            for (TranslationUnitDecl::decl_iterator i = unit->decls_begin(), e = unit->decls_end(); i != e; ++ i) {
+                VarDecl * vdecl = dyn_cast<VarDecl>(*i);
+                if (!vdecl) {
+                    continue;
+                }
+                int64_t offset = data.offset(vdecl);
+                if (offset >= 0 && !isa<ConstantArrayType>(vdecl->getType().getTypePtr())) {
+                    mScalarGlobals[vdecl] = offset;
+                    continue;
+                }
+                unsigned lanes = mGlobals.size();
+                mGlobals.resize(lanes + mLanes, 0);
+                mGlobalVars[vdecl] = lanes;
+                if (offset >= 0) {
+                    /// A global array evaluates to its address
+                    for (unsigned k = 0; k < mLanes; k++) {
+                        mGlobals[lanes + k] = mMemory.globalsBegin() + k * mImageSize + offset;
+                    }
+                }
+                else if (vdecl->hasInit()) {
+                    int64_t * value = eval(vdecl->getInit(), all);
+                    memcpy(&mGlobals[lanes], value, mLanes * sizeof(int64_t));
+                }
+            }
+            /// The initializers that are not constants, in order, like Environment::init
+            for (const DataSegment::DynamicInit & dynamic : data.dynamic()) {
+                int64_t * value = eval(dynamic.init, all);
+                int64_t width = mMemory.width(dynamic.type);
+                for (unsigned k = 0; k < mLanes; k++) {
+                    if (all[k] && !mMemory.store(mMemory.globalsBegin() + k * mImageSize + dynamic.offset, width, value[k])) {
+                        laneError(k, "[ERROR] Invalid Memory Access");
+                    }
+                }
+            }
+            exec(entry->getBody(), all);
+        }
+        catch (const InterpreterError & error) {
+            /// Lanes that already returned from main have all their output
+            for (unsigned k = 0; k < mLanes; k++) {
+                if (mStack.empty() || !mStack.front().mReturned[k]) {
+                    laneError(k, error.what());
+                }
+            }
+        }
+        for (unsigned k = 0; k < mLanes; k++) {
+            mOut[k]->flush();
+            if (!mDead[k]) {
+                mJobs[k]->status = "ok";
+            }
+        }
+    }
+};
+
+#endif //ASSIGN1_VECTORENGINE_H
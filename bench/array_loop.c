@@ -0,0 +1,36 @@
+extern int GET();
+extern void * MALLOC(int);
+extern void FREE(void *);
+extern void PRINT(int);
+
+int n = 1000;
+int scale = 3;
+
+int twice(int x) {
+   return x + x;
+}
+
+int main() {
+   int a[1000];
+   int i;
+   int r;
+   int s;
+   r = 0;
+   s = 0;
+   while (r < 200) {
+      for (i = 0; i < n; i = i + 1) {
+         a[i] = i * (scale + 1) + r;
+      }
+      for (i = 0; i < n; i = i + 1) {
+         s = s + a[i] * scale;
+      }
+      i = 0;
+      while (i < n) {
+         s = s + twice(a[i]);
+         i = i + 10;
+      }
+      r = r + 1;
+   }
+   PRINT(s);
+   return 0;
+}
@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+"""Measure how batch mode throughput scales with --jobs.
+
+Builds a manifest that repeats every program in the bench directory --copies
+times (with its .in file as input when there is one), runs it with --jobs of
+1, 2, 4, ... up to the number of cores and prints programs per second and the
+speedup over one job.  Every run must report status "ok" for every program.
+
+    batch_scale.py --interpreter build/ast-interpreter [--copies 20] [bench_dir]
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def job_counts(cores):
+    counts = []
+    n = 1
+    while n < cores:
+        counts.append(n)
+        n *= 2
+    counts.append(cores)
+    return counts
+
+
+def run(interpreter, manifest, jobs):
+    start = time.perf_counter()
+    proc = subprocess.run([interpreter, "--batch=" + manifest, "--jobs=%d" % jobs],
+                          stdout=subprocess.PIPE, stderr=subprocess.DEVNULL)
+    wall = time.perf_counter() - start
+    results = [json.loads(line) for line in proc.stdout.decode("utf-8").splitlines()]
+    failed = [r["program"] for r in results if r["status"] != "ok"]
+    if proc.returncode != 0 or failed:
+        sys.exit("--jobs=%d failed: status %d, %s" % (jobs, proc.returncode, failed[:5]))
+    return wall, len(results)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--interpreter", required=True)
+    parser.add_argument("--copies", type=int, default=20, help="times each program is repeated")
+    parser.add_argument("--max-jobs", type=int, default=os.cpu_count() or 1)
+    parser.add_argument("bench_dir", nargs="?", default=os.path.dirname(os.path.abspath(__file__)))
+    args = parser.parse_args()
+
+    lines = []
+    for name in sorted(os.listdir(args.bench_dir)):
+        if not name.endswith(".c"):
+            continue
+        program = os.path.join(args.bench_dir, name)
+        stdin = os.path.splitext(program)[0] + ".in"
+        lines.append(program + (" " + stdin if os.path.exists(stdin) else ""))
+    with tempfile.NamedTemporaryFile("w", suffix=".txt", delete=False) as f:
+        f.write("\n".join(lines * args.copies) + "\n")
+        manifest = f.name
+
+    try:
+        base = None
+        for jobs in job_counts(args.max_jobs):
+            wall, count = run(args.interpreter, manifest, jobs)
+            base = base or wall
+            print("jobs %3d  %6d programs  %8.2f s  %8.1f programs/s  speedup %.2f"
+                  % (jobs, count, wall, count / wall, base / wall))
+    finally:
+        os.unlink(manifest)
+
+
+if __name__ == "__main__":
+    main()
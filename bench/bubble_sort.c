@@ -0,0 +1,40 @@
+extern int GET();
+extern void * MALLOC(int);
+extern void FREE(void *);
+extern void PRINT(int);
+
+int main() {
+   int a[300];
+   int n;
+   int i;
+   int j;
+   int x;
+   int t;
+
+   n = 300;
+   x = 7;
+   i = 0;
+   while (i < n) {
+      x = x * 37 + 11;
+      x = x - (x / 1009) * 1009;
+      a[i] = x;
+      i = i + 1;
+   }
+
+   i = 0;
+   while (i < n) {
+      j = 0;
+      while (j < n - i - 1) {
+         if (a[j] > a[j + 1]) {
+            t = a[j];
+            a[j] = a[j + 1];
+            a[j + 1] = t;
+         }
+         j = j + 1;
+      }
+      i = i + 1;
+   }
+   PRINT(a[0]);
+   PRINT(a[n - 1]);
+   return 0;
+}
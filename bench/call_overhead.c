@@ -0,0 +1,33 @@
+extern int GET();
+extern void * MALLOC(int);
+extern void FREE(void *);
+extern void PRINT(int);
+
+int mul(int a, int b) {
+   return a * b;
+}
+
+int add3(int a, int b, int c) {
+   return a + b + c;
+}
+
+int square(int x) {
+   return mul(x, x);
+}
+
+int main() {
+   int i;
+   int s;
+   int t;
+   int u;
+   s = 0;
+   i = 0;
+   while (i < 100000) {
+      t = mul(i, 3);
+      u = square(i);
+      s = add3(s, t, u);
+      i = i + 1;
+   }
+   PRINT(s);
+   return 0;
+}
@@ -0,0 +1,46 @@
+#!/usr/bin/env python3
+"""Check that a long guest loop runs in flat memory.
+
+Runs bench/long_loop.c with a short and a long trip count and fails when the
+peak RSS of the long run exceeds the short one by more than --tolerance KB.
+
+    check_rss.py --interpreter build/ast-interpreter
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+
+
+def peak_rss(interpreter, program, trips):
+    proc = subprocess.Popen([interpreter, program], stdin=subprocess.PIPE,
+                            stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    proc.stdin.write(b"%d\n" % trips)
+    proc.stdin.close()
+    _, status, usage = os.wait4(proc.pid, 0)
+    if status != 0:
+        sys.exit("%s failed with status %d" % (program, status))
+    return usage.ru_maxrss
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--interpreter", required=True)
+    parser.add_argument("--program", default=os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                                          "long_loop.c"))
+    parser.add_argument("--short", type=int, default=1000)
+    parser.add_argument("--long", type=int, default=500000)
+    parser.add_argument("--tolerance", type=int, default=1024, help="allowed growth in KB")
+    args = parser.parse_args()
+
+    short = peak_rss(args.interpreter, args.program, args.short)
+    long = peak_rss(args.interpreter, args.program, args.long)
+    print("peak rss: %d trips %d KB, %d trips %d KB" % (args.short, short, args.long, long))
+    if long - short > args.tolerance:
+        sys.exit("memory grows with the trip count: +%d KB" % (long - short))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,21 @@
+extern int GET();
+extern void * MALLOC(int);
+extern void FREE(void *);
+extern void PRINT(int);
+
+int fib(int n) {
+   int a;
+   int b;
+   if (n < 2)
+      return n;
+   a = fib(n - 1);
+   b = fib(n - 2);
+   return a + b;
+}
+
+int main() {
+   int r;
+   r = fib(22);
+   PRINT(r);
+   return 0;
+}
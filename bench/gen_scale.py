@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+"""Generate a synthetic MiniC program of configurable size.
+
+Knobs (all optional, see --help for defaults):
+  --functions  number of small guest functions, all called from main's loop
+  --globals    number of initialized global variables
+  --depth      nesting depth of the generated arithmetic expression
+  --recursion  depth of one recursive call chain
+  --trips      trip count of main's loop
+  --array      size of a local array filled and summed in main
+
+Only constructs the interpreter supports are emitted: while loops, + - * /
+< > ==, locals and arrays, and globals read from main only.
+
+    gen_scale.py --functions 1000 --trips 10 > big.c
+"""
+
+import argparse
+import sys
+
+BUILTINS = """extern int GET();
+extern void * MALLOC(int);
+extern void FREE(void *);
+extern void PRINT(int);
+"""
+
+DEFAULTS = {
+    "functions": 10,
+    "globals": 10,
+    "depth": 4,
+    "recursion": 10,
+    "trips": 100,
+    "array": 100,
+}
+
+
+def expression(depth, leaf):
+    """Nested expression over `leaf` of the given depth, evaluates to small values."""
+    expr = leaf
+    for level in range(depth):
+        if level % 3 == 0:
+            expr = "(%s + %d)" % (expr, level + 1)
+        elif level % 3 == 1:
+            expr = "(%s * 2)" % expr
+        else:
+            expr = "(%s / 2)" % expr
+    return expr
+
+
+def generate(functions, globals, depth, recursion, trips, array):
+    out = [BUILTINS]
+    for g in range(globals):
+        out.append("int g%d = %d + %d * 3;" % (g, g % 7, g % 5))
+    out.append("")
+
+    out.append("int rec(int n) {")
+    out.append("   int r;")
+    out.append("   if (n < 1)")
+    out.append("      return 0;")
+    out.append("   r = rec(n - 1);")
+    out.append("   return r + 1;")
+    out.append("}")
+    out.append("")
+
+    for f in range(functions):
+        out.append("int f%d(int a) {" % f)
+        out.append("   int t;")
+        out.append("   t = %s;" % expression(depth, "a"))
+        out.append("   return t - (t / 1000) * 1000 + %d;" % (f % 10))
+        out.append("}")
+        out.append("")
+
+    out.append("int main() {")
+    out.append("   int i;")
+    out.append("   int s;")
+    out.append("   int r;")
+    if array > 0:
+        out.append("   int arr[%d];" % array)
+    out.append("   s = 0;")
+    for g in range(globals):
+        out.append("   s = s + g%d;" % g)
+    out.append("   r = rec(%d);" % recursion)
+    out.append("   s = s + r;")
+    if array > 0:
+        out.append("   i = 0;")
+        out.append("   while (i < %d) {" % array)
+        out.append("      arr[i] = i * 3;")
+        out.append("      i = i + 1;")
+        out.append("   }")
+        out.append("   i = 0;")
+        out.append("   while (i < %d) {" % array)
+        out.append("      s = s + arr[i];")
+        out.append("      i = i + 1;")
+        out.append("   }")
+    out.append("   i = 0;")
+    out.append("   while (i < %d) {" % trips)
+    out.append("      s = s + %s;" % expression(depth, "i"))
+    for f in range(functions):
+        out.append("      s = s + f%d(i);" % f)
+    out.append("      s = s - (s / 100000) * 100000;")
+    out.append("      i = i + 1;")
+    out.append("   }")
+    out.append("   PRINT(s);")
+    out.append("   return 0;")
+    out.append("}")
+    return "\n".join(out) + "\n"
+
+
+def add_arguments(parser):
+    for knob, default in DEFAULTS.items():
+        parser.add_argument("--" + knob, type=int, default=default)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    add_arguments(parser)
+    parser.add_argument("-o", "--output", help="write the program here instead of stdout")
+    args = parser.parse_args()
+    code = generate(**{knob: getattr(args, knob) for knob in DEFAULTS})
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(code)
+    else:
+        sys.stdout.write(code)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,276 @@
+#!/usr/bin/env python3
+"""Pick the superinstructions of the IR interpreter from an opcode profile and generate them.
+
+With --interpreter, runs every testcase and every bench program with
+--engine=ir --op-profile on the same random GET input as ir_check.py and adds
+up the opcode pair and triple counts into bench/op_profile.txt.  With
+--profile, reads such a file instead.  Without either it reads
+bench/op_profile.txt, and fails if there is none.  --defaults skips the
+profile and takes the hand-picked sequences of DEFAULTS; it only bootstraps a
+tree that has no profile yet, whose generated files say so in their first line.
+--check regenerates the files from bench/op_profile.txt into a temporary
+directory and fails unless they match the ones in --out, so the committed
+selection can always be reproduced from the committed profile.
+
+A program that times out stops the profiling, since the counts would depend on
+the machine.  Programs that fail are left out and listed as "#" lines at the
+top of the profile.
+
+A sequence can be fused when every opcode has a handler below and only its
+last one branches.  Sequences are picked greedily by the dispatches they
+save (count * (length - 1)); a picked triple takes its count off the two
+pairs it contains.  Ties go to the sequence that sorts first, so the same
+profile always gives the same selection.  Writes IRSuperinsts.h (opcodes and
+patterns) and IRSuperinstCases.inc (the interpreter's handlers).
+
+    gen_superinsts.py --interpreter build/ast-interpreter [--count 8] [dir...]
+    gen_superinsts.py [--profile bench/op_profile.txt | --defaults | --check] [--count 8]
+"""
+
+import argparse
+import os
+import random
+import subprocess
+import sys
+import tempfile
+
+ENUM = {
+    "const": "Const", "copy": "Copy", "add": "Add", "sub": "Sub", "mul": "Mul", "div": "Div",
+    "lt": "Lt", "gt": "Gt", "eq": "Eq", "neg": "Neg", "global": "Global", "local": "Local",
+    "load": "Load", "loads": "LoadS", "store": "Store", "br": "Br", "condbr": "CondBr",
+}
+
+MEMORY_ERROR = ["    fatal(\"[ERROR] Invalid Memory Access\");", "}}"]
+
+# Handler of each opcode that can be part of a superinstruction, for the instruction {i}
+HANDLERS = {
+    "const": ["r[{i}.dst] = {i}.imm;"],
+    "copy": ["r[{i}.dst] = r[{i}.a];"],
+    "add": ["r[{i}.dst] = r[{i}.a] + r[{i}.b];"],
+    "sub": ["r[{i}.dst] = r[{i}.a] - r[{i}.b];"],
+    "mul": ["r[{i}.dst] = r[{i}.a] * r[{i}.b];"],
+    "div": ["if (r[{i}.b] == 0) {{", "    fatal(\"[ERROR] Dived By Zero\");", "}}",
+            "r[{i}.dst] = r[{i}.a] / r[{i}.b];"],
+    "lt": ["r[{i}.dst] = r[{i}.a] < r[{i}.b];"],
+    "gt": ["r[{i}.dst] = r[{i}.a] > r[{i}.b];"],
+    "eq": ["r[{i}.dst] = r[{i}.a] == r[{i}.b];"],
+    "neg": ["r[{i}.dst] = -r[{i}.a];"],
+    "global": ["r[{i}.dst] = mMemory.globalsBegin() + {i}.imm;"],
+    "local": ["r[{i}.dst] = frame + {i}.imm;"],
+    "load": ["if (!mMemory.load(r[{i}.a], {i}.imm, false, r[{i}.dst])) {{"] + MEMORY_ERROR,
+    "loads": ["if (!mMemory.load(r[{i}.a], {i}.imm, true, r[{i}.dst])) {{"] + MEMORY_ERROR,
+    "store": ["if (!mMemory.store(r[{i}.a], {i}.imm, r[{i}.b])) {{"] + MEMORY_ERROR,
+    "br": ["pc = code + {i}.imm;"],
+    "condbr": ["pc = code + (r[{i}.a] ? {i}.imm : {i}.b);"],
+}
+BRANCHES = ("br", "condbr")
+
+# Bootstrap only, for --defaults : what "load local, load local, compare, branch" and
+# "load local, add constant, store local" come to in the IR, where scalar locals live in registers
+DEFAULTS = [
+    ("const", "add"),
+    ("lt", "condbr"),
+    ("const", "lt", "condbr"),
+    ("gt", "condbr"),
+    ("eq", "condbr"),
+    ("add", "br"),
+    ("global", "loads"),
+    ("mul", "add", "loads"),
+]
+
+NAMES = ["inst", "next", "third"]
+
+
+def fusible(seq):
+    return all(op in HANDLERS for op in seq) and not any(op in BRANCHES for op in seq[:-1])
+
+
+def read_profile(path, counts):
+    with open(path) as f:
+        for line in f:
+            fields = line.split()
+            if len(fields) >= 3 and fields[0] in ("2", "3") and len(fields) == int(fields[0]) + 2:
+                seq = tuple(fields[1:-1])
+                counts[seq] = counts.get(seq, 0) + int(fields[-1])
+
+
+def write_profile(path, counts, skipped):
+    with open(path, "w") as f:
+        for name, reason in skipped:
+            f.write("# skipped %s: %s\n" % (name, reason))
+        for seq in sorted(counts):
+            f.write("%d %s %d\n" % (len(seq), " ".join(seq), counts[seq]))
+
+
+def profile_corpus(interpreter, dirs, timeout):
+    rng = random.Random(0)
+    counts = {}
+    skipped = []
+    with tempfile.TemporaryDirectory() as tmp:
+        input_path = os.path.join(tmp, "input.txt")
+        profile_path = os.path.join(tmp, "profile.txt")
+        with open(input_path, "w") as f:
+            f.write(" ".join(str(rng.randint(1, 30)) for _ in range(64)) + "\n")
+        for d in dirs:
+            for name in sorted(os.listdir(d)):
+                if not name.endswith(".c"):
+                    continue
+                cmd = [interpreter, "--engine=ir", "--print-to=stdout", "--input=" + input_path,
+                       "--op-profile=" + profile_path, os.path.join(d, name)]
+                try:
+                    proc = subprocess.run(cmd, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, timeout=timeout)
+                except subprocess.TimeoutExpired:
+                    sys.exit("%s timed out, raise --timeout" % name)
+                if proc.returncode != 0 or not os.path.exists(profile_path):
+                    print("skip %s: no profile" % name, file=sys.stderr)
+                    skipped.append((name, "exit %d" % proc.returncode))
+                    continue
+                read_profile(profile_path, counts)
+                os.remove(profile_path)
+    return counts, skipped
+
+
+def select(counts, count):
+    left = {seq: n for seq, n in counts.items() if len(seq) in (2, 3) and fusible(seq)}
+    picked = []
+    while left and len(picked) < count:
+        seq = min(left, key=lambda s: (-left[s] * (len(s) - 1), s))
+        if left[seq] <= 0:
+            break
+        picked.append((seq, left.pop(seq)))
+        if len(seq) == 3:
+            for pair in (seq[:2], seq[1:]):
+                if pair in left:
+                    left[pair] -= picked[-1][1]
+    return picked
+
+
+def opcode(seq):
+    return "IR_" + "".join(ENUM[op] for op in seq)
+
+
+def header(source):
+    return ["// Generated by bench/gen_superinsts.py from %s. Do not edit." % source, ""]
+
+
+def write_header(path, picked, source):
+    lines = header(source) + [
+        "#ifndef ASSIGN1_IRSUPERINSTS_H",
+        "#define ASSIGN1_IRSUPERINSTS_H",
+        "",
+        "#include <stdint.h>",
+        "",
+        "#include \"IR.h\"",
+        "",
+        "/// Superinstructions of the IR interpreter, numbered after the IROps. Each one runs a",
+        "/// sequence of instructions in one dispatch, see fuseSuperinsts",
+        "enum IRSuperOp : uint8_t {",
+    ]
+    for k, (seq, _) in enumerate(picked):
+        lines.append("    %s%s," % (opcode(seq), " = IR_NumOps" if k == 0 else ""))
+    lines += [
+        "    IR_NumSuperOps",
+        "};",
+        "",
+        "struct IRSuperinst {",
+        "    uint8_t op;",
+        "    uint8_t length;",
+        "    IROp ops[3];",
+        "};",
+        "",
+        "/// The sequence each superinstruction runs" +
+        (", with its count in the profile" if any(n for _, n in picked) else ""),
+        "static const IRSuperinst kIRSuperinsts[] = {",
+    ]
+    for seq, n in picked:
+        ops = ["IR_" + ENUM[op] for op in seq] + ["IR_NumOps"] * (3 - len(seq))
+        lines.append("    { %s, %d, { %s } },%s" % (opcode(seq), len(seq), ", ".join(ops),
+                                                   "  // %d" % n if n else ""))
+    lines += ["};", "", "#endif //ASSIGN1_IRSUPERINSTS_H", ""]
+    with open(path, "w") as f:
+        f.write("\n".join(lines))
+
+
+def write_cases(path, picked, source):
+    lines = header(source) + ["// The cases of IRInterpreter::execute for the superinstructions of IRSuperinsts.h", ""]
+    indent = " " * 16
+    for seq, _ in picked:
+        lines.append(indent + "case %s: {" % opcode(seq))
+        for k in range(1, len(seq)):
+            lines.append(indent + "    const IRInst & %s = pc[%d];" % (NAMES[k], k - 1))
+        for k, op in enumerate(seq):
+            lines += [indent + "    " + line.format(i=NAMES[k]) for line in HANDLERS[op]]
+        if seq[-1] not in BRANCHES:
+            lines.append(indent + "    pc += %d;" % (len(seq) - 1))
+        lines += [indent + "    break;", indent + "}"]
+    with open(path, "w") as f:
+        f.write("\n".join(lines) + "\n")
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    root = os.path.dirname(here)
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--interpreter")
+    parser.add_argument("--profile")
+    parser.add_argument("--defaults", action="store_true",
+                        help="bootstrap from the hand-picked sequences instead of a profile")
+    parser.add_argument("--check", action="store_true",
+                        help="fail unless bench/op_profile.txt gives the files in --out")
+    parser.add_argument("--count", type=int, default=8)
+    parser.add_argument("--timeout", type=int, default=120)
+    parser.add_argument("--out", default=root)
+    parser.add_argument("dirs", nargs="*", default=[os.path.join(root, "testcases"), here])
+    args = parser.parse_args()
+
+    saved = os.path.join(here, "op_profile.txt")
+    corpus = "bench/op_profile.txt, a profile of testcases/ and bench/"
+    if args.check:
+        if not os.path.exists(saved):
+            sys.exit("no bench/op_profile.txt: run make superinsts and commit it with the generated files")
+        with tempfile.TemporaryDirectory() as tmp:
+            counts = {}
+            read_profile(saved, counts)
+            picked = select(counts, args.count)
+            write_header(os.path.join(tmp, "IRSuperinsts.h"), picked, corpus)
+            write_cases(os.path.join(tmp, "IRSuperinstCases.inc"), picked, corpus)
+            for name in ("IRSuperinsts.h", "IRSuperinstCases.inc"):
+                with open(os.path.join(tmp, name)) as f, open(os.path.join(args.out, name)) as g:
+                    if f.read() != g.read():
+                        sys.exit("%s does not match bench/op_profile.txt, run make superinsts" % name)
+        print("IRSuperinsts.h and IRSuperinstCases.inc match bench/op_profile.txt")
+        return
+
+    if args.interpreter:
+        counts, skipped = profile_corpus(args.interpreter, args.dirs, args.timeout)
+        write_profile(saved, counts, skipped)
+        source = corpus
+    elif args.defaults:
+        counts = None
+        source = "its hand-picked DEFAULTS, without a profile"
+    elif args.profile:
+        counts = {}
+        read_profile(args.profile, counts)
+        source = "the profile " + os.path.basename(args.profile)
+    elif os.path.exists(saved):
+        counts = {}
+        read_profile(saved, counts)
+        source = corpus
+    else:
+        sys.exit("no profile: run with --interpreter (make superinsts) or --profile, or pass --defaults")
+
+    if counts is None:
+        picked = [(seq, 0) for seq in DEFAULTS[:args.count]]
+    else:
+        picked = select(counts, args.count)
+    if not picked:
+        sys.exit("no sequence to fuse")
+    write_header(os.path.join(args.out, "IRSuperinsts.h"), picked, source)
+    write_cases(os.path.join(args.out, "IRSuperinstCases.inc"), picked, source)
+    for seq, n in picked:
+        print("%-24s %-28s %12s" % (opcode(seq), " ".join(seq), n if n else "-"))
+
+
+if __name__ == "__main__":
+    main()
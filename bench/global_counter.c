@@ -0,0 +1,34 @@
+extern int GET();
+extern void * MALLOC(int);
+extern void FREE(void *);
+extern void PRINT(int);
+
+int calls;
+int depth;
+int deepest;
+
+int fib(int n) {
+   int a;
+   int b;
+   calls = calls + 1;
+   depth = depth + 1;
+   if (depth > deepest)
+      deepest = depth;
+   if (n < 2) {
+      depth = depth - 1;
+      return n;
+   }
+   a = fib(n - 1);
+   b = fib(n - 2);
+   depth = depth - 1;
+   return a + b;
+}
+
+int main() {
+   int r;
+   r = fib(22);
+   PRINT(r);
+   PRINT(calls);
+   PRINT(deepest);
+   return 0;
+}
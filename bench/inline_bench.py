@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+"""Measure what inlining saves on call heavy programs.
+
+Runs each program with the AST engine, with --engine=ir without the inline
+pass and with the default pipeline (which inlines), checks that all three
+print the same and reports the median wall time of each and the speedup of
+inlining.  The IR instruction counts before and after the passes come from
+--pass-stats=json.
+
+    inline_bench.py --interpreter build/ast-interpreter [program...]
+"""
+
+import argparse
+import json
+import os
+import statistics
+import subprocess
+import sys
+import time
+
+NO_INLINE = "constprop,copyprop,dce,simplifycfg,licm,strength"
+CONFIGS = [
+    ("ast", ["--engine=ast"]),
+    ("ir", ["--engine=ir", "--passes=" + NO_INLINE]),
+    ("ir+inline", ["--engine=ir"]),
+]
+
+
+def run(interpreter, program, extra):
+    start = time.perf_counter()
+    proc = subprocess.run([interpreter, "--print-to=stdout"] + extra + [program],
+                          stdin=subprocess.DEVNULL, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    wall = time.perf_counter() - start
+    if proc.returncode != 0:
+        sys.exit("%s %s failed: %s" % (program, " ".join(extra), proc.stderr.decode("utf-8", "replace")[-2000:]))
+    return wall, proc.stdout, proc.stderr.decode("utf-8", "replace")
+
+
+def instructions(interpreter, program, extra):
+    _, _, err = run(interpreter, program, extra + ["--pass-stats=json"])
+    start = err.find('{"before"')
+    if start < 0:
+        return None
+    return json.loads(err[start:].splitlines()[0])["after"]
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--interpreter", required=True)
+    parser.add_argument("--reps", type=int, default=5)
+    parser.add_argument("programs", nargs="*",
+                        default=[os.path.join(here, "call_overhead.c"), os.path.join(here, "fib.c"),
+                                 os.path.join(os.path.dirname(here), "testcases", "test24.c")])
+    args = parser.parse_args()
+
+    print("%-20s %-10s %10s %8s %8s" % ("program", "engine", "median_s", "insts", "speedup"))
+    for program in args.programs:
+        name = os.path.basename(program)
+        expected = None
+        medians = {}
+        for label, extra in CONFIGS:
+            walls = []
+            for _ in range(args.reps):
+                wall, out, _ = run(args.interpreter, program, extra)
+                walls.append(wall)
+                if expected is None:
+                    expected = out
+                elif out != expected:
+                    sys.exit("%s prints something else with %s" % (name, label))
+            medians[label] = statistics.median(walls)
+            insts = instructions(args.interpreter, program, extra) if label != "ast" else None
+            speedup = medians["ir"] / medians[label] if label == "ir+inline" else None
+            print("%-20s %-10s %10.4f %8s %8s" % (name, label, medians[label],
+                                                   "-" if insts is None else insts,
+                                                   "-" if speedup is None else "%.2fx" % speedup))
+
+
+if __name__ == "__main__":
+    main()
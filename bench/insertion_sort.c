@@ -0,0 +1,50 @@
+extern int GET();
+extern void * MALLOC(int);
+extern void FREE(void *);
+extern void PRINT(int);
+
+int main() {
+   int a[400];
+   int n;
+   int i;
+   int j;
+   int x;
+   int key;
+   int go;
+
+   n = 400;
+   x = 3;
+   i = 0;
+   while (i < n) {
+      x = x * 41 + 7;
+      x = x - (x / 997) * 997;
+      a[i] = x;
+      i = i + 1;
+   }
+
+   i = 1;
+   while (i < n) {
+      key = a[i];
+      j = i - 1;
+      go = 1;
+      while (go == 1) {
+         if (j < 0) {
+            go = 0;
+         }
+         else {
+            if (a[j] > key) {
+               a[j + 1] = a[j];
+               j = j - 1;
+            }
+            else {
+               go = 0;
+            }
+         }
+      }
+      a[j + 1] = key;
+      i = i + 1;
+   }
+   PRINT(a[0]);
+   PRINT(a[n - 1]);
+   return 0;
+}
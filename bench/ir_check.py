@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+"""Check that the IR passes do not change what a program does.
+
+Runs every testcase and every bench program with --engine=ir once without any
+pass or superinstruction, once with each pass alone and once with the whole
+pipeline, all on the same random GET input, and fails when an output or an
+error differs from the plain run.  The plain run must also match the reference
+AST engine (--engine=ast), except for the programs of AST_DIFFERS.  With
+--pass-stats it also prints how many instructions the default pipeline removes
+from each program.
+
+    ir_check.py --interpreter build/ast-interpreter [dir...]
+"""
+
+import argparse
+import os
+import random
+import subprocess
+import sys
+import tempfile
+
+PASSES = ["inline", "constprop", "copyprop", "dce", "simplifycfg", "licm", "strength"]
+
+# The AST engine skips the init statement of a for loop and does not run calls in conditions
+# and initializers, the IR engine does both (see the README). These programs depend on it:
+# array_loop.c reuses i in a second for loop, which only the IR engine sets back to 0.
+AST_DIFFERS = {"array_loop.c"}
+
+
+def run(interpreter, program, input_path, passes, timeout, extra=()):
+    engine = ["--engine=ir", "--passes=" + passes] if passes is not None else ["--engine=ast"]
+    cmd = [interpreter] + engine + ["--print-to=stdout", "--input=" + input_path] + list(extra) + [program]
+    try:
+        proc = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE, timeout=timeout)
+    except subprocess.TimeoutExpired:
+        return None
+    return proc.stdout.decode("utf-8", "replace"), proc.stderr.decode("utf-8", "replace")
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--interpreter", required=True)
+    parser.add_argument("--timeout", type=int, default=120)
+    parser.add_argument("--pass-stats", action="store_true")
+    parser.add_argument("dirs", nargs="*", default=[os.path.join(os.path.dirname(here), "testcases"), here])
+    args = parser.parse_args()
+
+    rng = random.Random(0)
+    configs = PASSES + [",".join(PASSES)]
+    failures = 0
+    with tempfile.TemporaryDirectory() as tmp:
+        input_path = os.path.join(tmp, "input.txt")
+        with open(input_path, "w") as f:
+            f.write(" ".join(str(rng.randint(1, 30)) for _ in range(64)) + "\n")
+        for d in args.dirs:
+            for name in sorted(os.listdir(d)):
+                if not name.endswith(".c"):
+                    continue
+                program = os.path.join(d, name)
+                reference = run(args.interpreter, program, input_path, "none", args.timeout, ["--no-superinsts"])
+                if reference is None:
+                    print("skip %s: timed out" % name)
+                    continue
+                bad = ["--passes=" + c for c in configs
+                       if run(args.interpreter, program, input_path, c, args.timeout) != reference]
+                if name not in AST_DIFFERS:
+                    ast = run(args.interpreter, program, input_path, None, args.timeout)
+                    if ast is None:
+                        print("skip %s against --engine=ast: timed out" % name)
+                    elif ast != reference:
+                        bad.append("--engine=ast")
+                if bad:
+                    print("FAIL %s: differs with %s" % (name, " / ".join(bad)))
+                    failures += 1
+                    continue
+                print("ok   %s" % name)
+                if args.pass_stats:
+                    stats = run(args.interpreter, program, input_path, configs[-1], args.timeout,
+                                ["--pass-stats"])
+                    sys.stdout.write(stats[1][stats[1].find("[PASSES]"):] if stats else "")
+    if failures:
+        sys.exit("%d programs failed" % failures)
+
+
+if __name__ == "__main__":
+    main()
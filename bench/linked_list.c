@@ -0,0 +1,54 @@
+extern int GET();
+extern void * MALLOC(int);
+extern void FREE(void *);
+extern void PRINT(int);
+
+/// Nodes are two longs : the value and the address of the next node
+long * push(long * head, long value) {
+   long * node;
+   node = (long *)MALLOC(sizeof(long) * 2);
+   *node = value;
+   *(node + 1) = (long)head;
+   return node;
+}
+
+long sum(long * head) {
+   long s;
+   long * p;
+   s = 0;
+   p = head;
+   while ((long)p > 0) {
+      s = s + *p;
+      p = (long *)*(p + 1);
+   }
+   return s;
+}
+
+int main() {
+   long * head;
+   long * next;
+   long total;
+   int i;
+
+   head = (long *)0;
+   i = 0;
+   while (i < 2000) {
+      head = push(head, i);
+      i = i + 1;
+   }
+
+   total = 0;
+   i = 0;
+   while (i < 10) {
+      total = total + sum(head);
+      i = i + 1;
+   }
+   PRINT(total);
+
+   while ((long)head > 0) {
+      next = (long *)*(head + 1);
+      FREE(head);
+      head = next;
+   }
+   return 0;
+}
@@ -0,0 +1,33 @@
+extern int GET();
+extern void * MALLOC(int);
+extern void FREE(void *);
+extern void PRINT(int);
+
+int step(int x) {
+   int buf[8];
+   buf[x - (x / 8) * 8] = x;
+   return buf[x - (x / 8) * 8] * 2;
+}
+
+/// Runs GET() iterations, memory use must not depend on the trip count
+int main() {
+   int n;
+   int i;
+   int s;
+
+   n = GET();
+   i = 0;
+   s = 0;
+   while (i < n) {
+      int t;
+      int a[16];
+      t = i * 3 + 1;
+      a[i - (i / 16) * 16] = t;
+      s = s + a[i - (i / 16) * 16] - t;
+      s = s + step(i);
+      s = s - (s / 100000) * 100000;
+      i = i + 1;
+   }
+   PRINT(s);
+   return 0;
+}
@@ -0,0 +1,60 @@
+#!/usr/bin/env python3
+"""Measure what the loop passes save on loop heavy programs.
+
+Runs each program with --engine=ir without licm and strength and with the
+default pipeline (which has both), checks that they print the same and
+reports the median wall time of each, the IR instruction count after the
+passes and the speedup of the loop passes.
+
+    loop_bench.py --interpreter build/ast-interpreter [program...]
+"""
+
+import argparse
+import os
+import statistics
+import sys
+
+from inline_bench import instructions, run
+
+NO_LOOP = "inline,constprop,copyprop,dce,simplifycfg"
+CONFIGS = [
+    ("ir", ["--engine=ir", "--passes=" + NO_LOOP]),
+    ("ir+loop", ["--engine=ir"]),
+]
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--interpreter", required=True)
+    parser.add_argument("--reps", type=int, default=5)
+    parser.add_argument("programs", nargs="*",
+                        default=[os.path.join(here, name) for name in
+                                 ("array_loop.c", "sieve.c", "bubble_sort.c", "nested_loops.c")])
+    args = parser.parse_args()
+
+    print("%-20s %-10s %10s %8s %8s" % ("program", "engine", "median_s", "insts", "speedup"))
+    for program in args.programs:
+        name = os.path.basename(program)
+        expected = None
+        medians = {}
+        for label, extra in CONFIGS:
+            walls = []
+            for _ in range(args.reps):
+                wall, out, _ = run(args.interpreter, program, extra)
+                walls.append(wall)
+                if expected is None:
+                    expected = out
+                elif out != expected:
+                    sys.exit("%s prints something else with %s" % (name, label))
+            medians[label] = statistics.median(walls)
+            insts = instructions(args.interpreter, program, extra)
+            speedup = medians["ir"] / medians[label] if label == "ir+loop" else None
+            print("%-20s %-10s %10.4f %8s %8s" % (name, label, medians[label],
+                                                   "-" if insts is None else insts,
+                                                   "-" if speedup is None else "%.2fx" % speedup))
+
+
+if __name__ == "__main__":
+    main()
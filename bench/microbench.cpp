@@ -0,0 +1,210 @@
+//
+// Created by Critizero on 2021/10/22.
+//
+// Microbenchmarks of the building blocks in Environment.h :
+// StackFrame bindings, Heap::Malloc / Free, frame push / pop through
+// Environment::call / bindReturnValue and calculate() on expression trees,
+// quickened and generic.
+//
+//   microbench [filter]
+//
+
+#include <stdint.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "clang/Frontend/ASTUnit.h"
+#include "clang/Tooling/Tooling.h"
+#include "llvm/Support/Format.h"
+
+#include "Environment.h"
+
+/// Results are written here so the measured work is not optimized away
+static volatile int64_t gSink;
+static const char * gFilter = NULL;
+
+/// Run body(iterations) until it took long enough, print ns per operation
+template <typename Body>
+static void measure(const std::string & name, Body body) {
+    if (gFilter && name.find(gFilter) == std::string::npos) {
+        return;
+    }
+    uint64_t iterations = 1;
+    double seconds = 0;
+    while (true) {
+        auto start = std::chrono::steady_clock::now();
+        body(iterations);
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (seconds > 0.2 || iterations >= (1ull << 32)) {
+            break;
+        }
+        iterations *= seconds > 0.02 ? 2 : 10;
+    }
+    llvm::outs() << llvm::format("%-40s %12llu %10.2f ns/op\n", name.c_str(),
+                                 (unsigned long long)iterations, seconds * 1e9 / iterations);
+}
+
+static FunctionDecl * findFunction(ASTContext & context, const char * name) {
+    TranslationUnitDecl * unit = context.getTranslationUnitDecl();
+    for (auto i = unit->decls_begin(), e = unit->decls_end(); i != e; ++ i) {
+        if (FunctionDecl * fdecl = dyn_cast<FunctionDecl>(*i)) {
+            if (fdecl->getName().equals(name) && fdecl->getBody()) {
+                return fdecl;
+            }
+        }
+    }
+    return NULL;
+}
+
+static const char * gBuiltins =
+        "extern int GET();\n"
+        "extern void * MALLOC(int);\n"
+        "extern void FREE(void *);\n"
+        "extern void PRINT(int);\n";
+
+/// bindDecl / getDeclVal / bindStmt on a frame holding `count` locals
+static void benchStackFrame(int count) {
+    std::string code = gBuiltins;
+    code += "int main() {\n";
+    for (int i = 0; i < count; i++) {
+        code += "   int v" + std::to_string(i) + ";\n   v" + std::to_string(i) + " = " + std::to_string(i) + ";\n";
+    }
+    code += "   return 0;\n}\n";
+    std::unique_ptr<ASTUnit> ast = tooling::buildASTFromCode(code);
+    FunctionDecl * entry = findFunction(ast->getASTContext(), "main");
+
+    std::vector<Decl *> decls;
+    std::vector<Stmt *> exprs;
+    CompoundStmt * body = cast<CompoundStmt>(entry->getBody());
+    for (Stmt * stmt : body->body()) {
+        if (DeclStmt * decl_stmt = dyn_cast<DeclStmt>(stmt)) {
+            decls.push_back(decl_stmt->getSingleDecl());
+        }
+        else if (BinaryOperator * bop = dyn_cast<BinaryOperator>(stmt)) {
+            exprs.push_back(bop);
+        }
+    }
+
+    std::string suffix = "/" + std::to_string(count);
+    ExprSlots slots;
+    DataSegment data;
+    slots.analyze(ast->getASTContext().getTranslationUnitDecl(), entry, data);
+    StackFrame frame(&slots, entry, 0, 1);
+    for (Decl * decl : decls) {
+        frame.bindDecl(decl, 0);
+    }
+    measure("StackFrame::bindDecl" + suffix, [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++) {
+            frame.bindDecl(decls[i % decls.size()], i);
+        }
+    });
+    measure("StackFrame::getDeclVal" + suffix, [&](uint64_t n) {
+        int64_t sum = 0;
+        for (uint64_t i = 0; i < n; i++) {
+            sum += frame.getDeclVal(decls[i % decls.size()]);
+        }
+        gSink = sum;
+    });
+    measure("StackFrame::bindStmt+getStmtVal" + suffix, [&](uint64_t n) {
+        int64_t sum = 0;
+        for (uint64_t i = 0; i < n; i++) {
+            Stmt * stmt = exprs[i % exprs.size()];
+            frame.bindStmt(stmt, i);
+            sum += frame.getStmtVal(stmt);
+        }
+        gSink = sum;
+    });
+}
+
+/// Malloc + Free of one block while `live` other blocks stay allocated
+static void benchHeap(int live) {
+    GuestMemory memory(false);
+    Heap heap(memory);
+    std::vector<int64_t> blocks;
+    for (int i = 0; i < live; i++) {
+        blocks.push_back(heap.Malloc(16));
+    }
+    measure("Heap::Malloc+Free/live=" + std::to_string(live), [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++) {
+            int64_t addr = heap.Malloc(16 + (i & 7) * 8);
+            heap.Free(addr);
+        }
+    });
+    for (int64_t addr : blocks) {
+        heap.Free(addr);
+    }
+}
+
+/// One guest call without its body : argument evaluation, frame push and pop
+static void benchCall(const InterpreterOptions & options) {
+    std::string code = gBuiltins;
+    code += "int f(int a, int b) {\n   return a;\n}\n"
+            "int main() {\n   f(1, 2);\n   return 0;\n}\n";
+    std::unique_ptr<ASTUnit> ast = tooling::buildASTFromCode(code);
+    ASTContext & context = ast->getASTContext();
+    CallExpr * call = cast<CallExpr>(*cast<CompoundStmt>(findFunction(context, "main")->getBody())->body_begin());
+
+    Environment env(options);
+    env.init(context.getTranslationUnitDecl());
+    measure("Environment::call+bindReturnValue", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++) {
+            env.call(call);
+            env.bindReturnValue(call);
+        }
+    });
+}
+
+/// Balanced tree of + and * over a global and literals
+static std::string expressionTree(int depth, int & leaf) {
+    if (depth == 0) {
+        return (leaf++ % 2) ? "x" : std::to_string(leaf);
+    }
+    const char * op = depth % 2 ? " + " : " * ";
+    return "(" + expressionTree(depth - 1, leaf) + op + expressionTree(depth - 1, leaf) + ")";
+}
+
+static void benchCalculate(const InterpreterOptions & options, int depth) {
+    int leaf = 0;
+    std::string code = gBuiltins;
+    code += "int x = 3;\nint main() {\n   return " + expressionTree(depth, leaf) + ";\n}\n";
+    std::unique_ptr<ASTUnit> ast = tooling::buildASTFromCode(code);
+    ASTContext & context = ast->getASTContext();
+    CompoundStmt * body = cast<CompoundStmt>(findFunction(context, "main")->getBody());
+    Expr * expr = cast<ReturnStmt>(*body->body_begin())->getRetValue();
+
+    Environment env(options);
+    env.init(context.getTranslationUnitDecl());
+    measure("Environment::calculate/depth=" + std::to_string(depth) + (options.quicken ? "" : "/generic"), [&](uint64_t n) {
+        int64_t sum = 0;
+        for (uint64_t i = 0; i < n; i++) {
+            sum += env.calculate(expr);
+        }
+        gSink = sum;
+    });
+}
+
+int main(int argc, char ** argv) {
+    if (argc > 1) {
+        gFilter = argv[1];
+    }
+    InterpreterOptions options;
+    llvm::outs() << "benchmark                                  iterations          time\n";
+    for (int count : {8, 64, 512}) {
+        benchStackFrame(count);
+    }
+    for (int live : {0, 1000, 100000}) {
+        benchHeap(live);
+    }
+    benchCall(options);
+    for (int depth : {2, 6, 10}) {
+        benchCalculate(options, depth);
+    }
+    /// The same trees without quickening
+    InterpreterOptions generic;
+    generic.quicken = false;
+    for (int depth : {2, 6, 10}) {
+        benchCalculate(generic, depth);
+    }
+    return 0;
+}
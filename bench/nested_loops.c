@@ -0,0 +1,42 @@
+extern int GET();
+extern void * MALLOC(int);
+extern void FREE(void *);
+extern void PRINT(int);
+
+int main() {
+   int a[400];
+   int b[400];
+   int c[400];
+   int n;
+   int i;
+   int j;
+   int k;
+   int s;
+
+   n = 20;
+   i = 0;
+   while (i < n * n) {
+      a[i] = i / n + 1;
+      b[i] = i - (i / n) * n + 1;
+      i = i + 1;
+   }
+
+   i = 0;
+   while (i < n) {
+      j = 0;
+      while (j < n) {
+         s = 0;
+         k = 0;
+         while (k < n) {
+            s = s + a[i * n + k] * b[k * n + j];
+            k = k + 1;
+         }
+         c[i * n + j] = s;
+         j = j + 1;
+      }
+      i = i + 1;
+   }
+   PRINT(c[0]);
+   PRINT(c[n * n - 1]);
+   return 0;
+}
@@ -0,0 +1,34 @@
+extern int GET();
+extern void * MALLOC(int);
+extern void FREE(void *);
+extern void PRINT(int);
+
+int main() {
+   int * next;
+   int n;
+   int i;
+   int p;
+   int steps;
+   int sum;
+
+   n = 1000;
+   next = (int *)MALLOC(sizeof(int) * n);
+   i = 0;
+   while (i < n) {
+      p = i * 7 + 3;
+      *(next + i) = p - (p / n) * n;
+      i = i + 1;
+   }
+
+   p = 0;
+   sum = 0;
+   steps = 0;
+   while (steps < 20000) {
+      p = *(next + p);
+      sum = sum + p;
+      steps = steps + 1;
+   }
+   PRINT(sum);
+   FREE(next);
+   return 0;
+}
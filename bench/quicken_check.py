@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+"""Check that quickening does not change what a program does and report how much of it ran quickened.
+
+Runs every testcase and every bench program with the AST engine once with
+--no-quicken and once quickened, on the same random GET input, and fails when
+an output or an error differs.  For each program it prints the fraction of
+operations that ran in quickened form and the guard failures, from
+--quicken-stats.
+
+    quicken_check.py --interpreter build/ast-interpreter [dir...]
+"""
+
+import argparse
+import os
+import random
+import re
+import subprocess
+import sys
+import tempfile
+
+STATS = re.compile(r"\[QUICKEN\] (\d+) of (\d+) operations ran quickened \(([\d.]+)%\), (\d+) guard failures")
+
+
+def run(interpreter, program, input_path, extra, timeout):
+    cmd = [interpreter, "--print-to=stdout", "--input=" + input_path] + extra + [program]
+    try:
+        proc = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE, timeout=timeout)
+    except subprocess.TimeoutExpired:
+        return None
+    return proc.stdout.decode("utf-8", "replace"), proc.stderr.decode("utf-8", "replace")
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--interpreter", required=True)
+    parser.add_argument("--timeout", type=int, default=120)
+    parser.add_argument("dirs", nargs="*", default=[os.path.join(os.path.dirname(here), "testcases"), here])
+    args = parser.parse_args()
+
+    rng = random.Random(0)
+    failures = 0
+    quick = total = 0
+    with tempfile.TemporaryDirectory() as tmp:
+        input_path = os.path.join(tmp, "input.txt")
+        with open(input_path, "w") as f:
+            f.write(" ".join(str(rng.randint(1, 30)) for _ in range(64)) + "\n")
+        print("%-24s %14s %8s %8s" % ("program", "operations", "quick%", "guards"))
+        for d in args.dirs:
+            for name in sorted(os.listdir(d)):
+                if not name.endswith(".c"):
+                    continue
+                program = os.path.join(d, name)
+                reference = run(args.interpreter, program, input_path, ["--no-quicken"], args.timeout)
+                if reference is None:
+                    print("skip %s: timed out" % name)
+                    continue
+                result = run(args.interpreter, program, input_path, ["--quicken-stats"], args.timeout)
+                if result is None or result[0] != reference[0] or STATS.sub("", result[1]).rstrip() != reference[1].rstrip():
+                    print("FAIL %s: differs when quickened" % name)
+                    failures += 1
+                    continue
+                match = STATS.search(result[1])
+                if not match:
+                    print("%-24s %14s %8s %8s" % (name, "-", "-", "-"))
+                    continue
+                quick += int(match.group(1))
+                total += int(match.group(2))
+                print("%-24s %14s %8s %8s" % (name, match.group(2), match.group(3), match.group(4)))
+    if total:
+        print("%-24s %14d %8.1f" % ("all", total, 100.0 * quick / total))
+    if failures:
+        sys.exit("%d programs failed" % failures)
+
+
+if __name__ == "__main__":
+    main()
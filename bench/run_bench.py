@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+"""Run the MiniC benchmark programs under ast-interpreter and report JSON.
+
+For every program the interpreter is run --reps times; the report holds the
+median / min / max wall time and the peak RSS of the child.  When the
+interpreter is built with -DENABLE_STATS=ON one extra run with --stats=json
+counts the evaluated AST nodes, which gives nodes/sec.  A program `foo.c`
+reads its GET input from `foo.in` when that file exists.
+
+    run_bench.py --interpreter build/ast-interpreter bench/
+    run_bench.py ... --output new.json --baseline old.json
+"""
+
+import argparse
+import glob
+import json
+import os
+import statistics
+import subprocess
+import sys
+import time
+
+
+def run_once(interpreter, program, extra_args=()):
+    """Run one program, return (wall seconds, peak rss KB, stderr text)."""
+    stdin_path = os.path.splitext(program)[0] + ".in"
+    stdin = open(stdin_path, "rb") if os.path.exists(stdin_path) else subprocess.DEVNULL
+    try:
+        start = time.perf_counter()
+        proc = subprocess.Popen([interpreter] + list(extra_args) + [program],
+                                stdin=stdin, stdout=subprocess.DEVNULL,
+                                stderr=subprocess.PIPE)
+        err = proc.stderr.read()
+        _, _, usage = os.wait4(proc.pid, 0)
+        wall = time.perf_counter() - start
+    finally:
+        if stdin is not subprocess.DEVNULL:
+            stdin.close()
+    return wall, usage.ru_maxrss, err.decode("utf-8", "replace")
+
+
+def count_nodes(interpreter, program):
+    """Evaluated AST nodes from --stats=json, None without a stats build."""
+    _, _, err = run_once(interpreter, program, ["--stats=json"])
+    start = err.find('{"stmts"')
+    if start < 0:
+        return None
+    try:
+        stats = json.loads(err[start:].splitlines()[0])
+    except ValueError:
+        return None
+    return sum(s["visited"] + s["calculated"] for s in stats["stmts"].values())
+
+
+def bench(interpreter, program, reps):
+    walls = []
+    peak = 0
+    for _ in range(reps):
+        wall, rss, _ = run_once(interpreter, program)
+        walls.append(wall)
+        peak = max(peak, rss)
+    median = statistics.median(walls)
+    nodes = count_nodes(interpreter, program)
+    return {
+        "name": os.path.splitext(os.path.basename(program))[0],
+        "reps": reps,
+        "median_s": median,
+        "min_s": min(walls),
+        "max_s": max(walls),
+        "nodes": nodes,
+        "nodes_per_s": nodes / median if nodes and median > 0 else None,
+        "peak_rss_kb": peak,
+    }
+
+
+def compare(results, baseline_path):
+    with open(baseline_path) as f:
+        baseline = {b["name"]: b for b in json.load(f)["benchmarks"]}
+    for r in results:
+        old = baseline.get(r["name"])
+        if not old:
+            continue
+        speedup = old["median_s"] / r["median_s"] if r["median_s"] > 0 else float("inf")
+        print("%-20s %8.3fs -> %8.3fs  x%.2f   rss %d -> %d KB" % (
+            r["name"], old["median_s"], r["median_s"], speedup,
+            old["peak_rss_kb"], r["peak_rss_kb"]), file=sys.stderr)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--interpreter", required=True)
+    parser.add_argument("--reps", type=int, default=5)
+    parser.add_argument("--output", help="write the JSON report here instead of stdout")
+    parser.add_argument("--baseline", help="JSON report of an earlier build to compare with")
+    parser.add_argument("paths", nargs="+", help="benchmark programs or directories of them")
+    args = parser.parse_args()
+
+    programs = []
+    for path in args.paths:
+        if os.path.isdir(path):
+            programs += sorted(glob.glob(os.path.join(path, "*.c")))
+        else:
+            programs.append(path)
+
+    results = []
+    for program in programs:
+        result = bench(args.interpreter, program, args.reps)
+        print("%-20s median %.4fs  rss %d KB" % (result["name"], result["median_s"],
+                                                result["peak_rss_kb"]), file=sys.stderr)
+        results.append(result)
+
+    report = json.dumps({"interpreter": os.path.abspath(args.interpreter),
+                         "benchmarks": results}, indent=2, sort_keys=True)
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(report + "\n")
+    else:
+        print(report)
+    if args.baseline:
+        compare(results, args.baseline)
+
+
+if __name__ == "__main__":
+    main()
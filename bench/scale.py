@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+"""Measure how ast-interpreter scales with program size.
+
+For each knob of gen_scale.py, sweep its values while the other knobs keep
+their defaults, run the generated program with --phase-times=json and record
+the time of every phase and the peak RSS.  Results go to a CSV file; with
+matplotlib installed one PNG per knob is written as well.  The log-log slope
+of each phase against the knob is printed, a slope well above 1 points at
+super-linear behavior.
+
+    scale.py --interpreter build/ast-interpreter --outdir scale-results
+    scale.py ... --knob functions --values 10,100,1000,10000
+"""
+
+import argparse
+import csv
+import json
+import math
+import os
+import subprocess
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import gen_scale  # noqa: E402
+
+SWEEPS = {
+    "functions": [10, 100, 1000, 3000],
+    "globals": [10, 100, 1000, 10000],
+    "depth": [2, 8, 32, 128],
+    "recursion": [10, 100, 500, 2000],
+    "trips": [100, 1000, 10000, 100000],
+    "array": [100, 1000, 10000, 100000],
+}
+
+
+def run(interpreter, program):
+    proc = subprocess.Popen([interpreter, "--phase-times=json", program],
+                            stdin=subprocess.DEVNULL, stdout=subprocess.DEVNULL,
+                            stderr=subprocess.PIPE)
+    err = proc.stderr.read().decode("utf-8", "replace")
+    _, _, usage = os.wait4(proc.pid, 0)
+    start = err.find('{"phases"')
+    if start < 0:
+        raise RuntimeError("no phase report from %s:\n%s" % (program, err[-2000:]))
+    phases = json.loads(err[start:].splitlines()[0])["phases"]
+    return {p["name"]: p["wall_ms"] for p in phases}, usage.ru_maxrss
+
+
+def slope(xs, ys):
+    """Least squares slope in log-log space."""
+    pts = [(math.log(x), math.log(y)) for x, y in zip(xs, ys) if x > 0 and y > 0]
+    if len(pts) < 2:
+        return float("nan")
+    mx = sum(p[0] for p in pts) / len(pts)
+    my = sum(p[1] for p in pts) / len(pts)
+    den = sum((p[0] - mx) ** 2 for p in pts)
+    return sum((p[0] - mx) * (p[1] - my) for p in pts) / den if den else float("nan")
+
+
+def plot(outdir, knob, rows, phases):
+    try:
+        import matplotlib
+        matplotlib.use("Agg")
+        import matplotlib.pyplot as plt
+    except ImportError:
+        return
+    fig, (ax_time, ax_mem) = plt.subplots(1, 2, figsize=(11, 4))
+    xs = [r["value"] for r in rows]
+    for phase in phases:
+        ax_time.plot(xs, [r[phase] for r in rows], marker="o", label=phase)
+    ax_time.set(xscale="log", yscale="log", xlabel=knob, ylabel="wall ms")
+    ax_time.legend()
+    ax_mem.plot(xs, [r["peak_rss_kb"] for r in rows], marker="o")
+    ax_mem.set(xscale="log", xlabel=knob, ylabel="peak RSS KB")
+    fig.tight_layout()
+    fig.savefig(os.path.join(outdir, "scale_%s.png" % knob))
+    plt.close(fig)
+
+
+def sweep(interpreter, outdir, knob, values):
+    rows = []
+    phases = []
+    for value in values:
+        params = dict(gen_scale.DEFAULTS)
+        params[knob] = value
+        program = os.path.join(outdir, "%s_%d.c" % (knob, value))
+        with open(program, "w") as f:
+            f.write(gen_scale.generate(**params))
+        times, rss = run(interpreter, program)
+        for phase in times:
+            if phase not in phases:
+                phases.append(phase)
+        row = {"knob": knob, "value": value, "peak_rss_kb": rss}
+        row.update(times)
+        rows.append(row)
+        print("%-10s %8d  %s  rss %d KB" % (knob, value, "  ".join(
+            "%s %.1fms" % (p, times[p]) for p in times), rss), file=sys.stderr)
+    xs = [r["value"] for r in rows]
+    for phase in phases + ["peak_rss_kb"]:
+        print("%-10s slope of %-14s %.2f" % (knob, phase, slope(xs, [r.get(phase, 0) for r in rows])),
+              file=sys.stderr)
+    plot(outdir, knob, rows, phases)
+    return rows, phases
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--interpreter", required=True)
+    parser.add_argument("--outdir", default="scale-results")
+    parser.add_argument("--knob", choices=sorted(SWEEPS), action="append",
+                        help="knob to sweep, may be repeated (default: all)")
+    parser.add_argument("--values", help="comma separated values for a single --knob")
+    args = parser.parse_args()
+
+    os.makedirs(args.outdir, exist_ok=True)
+    knobs = args.knob or sorted(SWEEPS)
+    if args.values and len(knobs) != 1:
+        parser.error("--values needs exactly one --knob")
+
+    all_rows = []
+    all_phases = []
+    for knob in knobs:
+        values = [int(v) for v in args.values.split(",")] if args.values else SWEEPS[knob]
+        rows, phases = sweep(args.interpreter, args.outdir, knob, values)
+        all_rows += rows
+        all_phases += [p for p in phases if p not in all_phases]
+
+    with open(os.path.join(args.outdir, "scale.csv"), "w", newline="") as f:
+        writer = csv.DictWriter(f, fieldnames=["knob", "value"] + all_phases + ["peak_rss_kb"],
+                                restval="")
+        writer.writeheader()
+        writer.writerows(all_rows)
+
+
+if __name__ == "__main__":
+    main()
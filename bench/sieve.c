@@ -0,0 +1,37 @@
+extern int GET();
+extern void * MALLOC(int);
+extern void FREE(void *);
+extern void PRINT(int);
+
+int main() {
+   int n;
+   int i;
+   int j;
+   int count;
+   int * s;
+
+   n = 1000000;
+   s = (int *)MALLOC(n * sizeof(int));
+   i = 0;
+   while (i < n) {
+      *(s + i) = 1;
+      i = i + 1;
+   }
+
+   count = 0;
+   i = 2;
+   while (i < n) {
+      if (*(s + i) == 1) {
+         count = count + 1;
+         j = i + i;
+         while (j < n) {
+            *(s + j) = 0;
+            j = j + i;
+         }
+      }
+      i = i + 1;
+   }
+   PRINT(count);
+   FREE(s);
+   return 0;
+}
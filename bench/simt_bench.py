@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+"""Compare the scalar and the lockstep (SIMT) engine on a parameter sweep.
+
+Writes --inputs random parameter sets for bench/sweep/param_sweep.c (or the
+given program), runs them with --engine=ast and with --engine=simt for each
+--lanes value on one thread, checks that every input prints the same in both
+engines and reports inputs per second and the speedup over the scalar engine.
+The --check programs only have to print the same with --engine=ast, with
+--engine=ir and with --engine=simt at every --lanes value.  By default they
+are bench/sweep/global_table.c, which keeps its state in global arrays, and
+bench/sweep/global_wrap.c, whose int and char globals overflow their width.
+
+    simt_bench.py --interpreter build/ast-interpreter [--lanes 4,8,16,32]
+"""
+
+import argparse
+import json
+import os
+import random
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def run(interpreter, program, input_list, extra):
+    start = time.perf_counter()
+    proc = subprocess.run([interpreter, "--inputs=" + input_list, "--jobs=1"] + extra + [program],
+                          stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    wall = time.perf_counter() - start
+    if proc.returncode != 0:
+        sys.exit("%s failed: %s" % (" ".join(extra), proc.stderr.decode("utf-8", "replace")[-2000:]))
+    results = [json.loads(line) for line in proc.stdout.decode("utf-8").splitlines()]
+    return wall, [(r["status"], r["output"]) for r in results]
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--interpreter", required=True)
+    parser.add_argument("--inputs", type=int, default=256)
+    parser.add_argument("--lanes", default="4,8,16,32")
+    parser.add_argument("--check", action="append",
+                        help="program whose output must agree, repeatable")
+    parser.add_argument("program", nargs="?", default=os.path.join(here, "sweep", "param_sweep.c"))
+    args = parser.parse_args()
+    checks = args.check or [os.path.join(here, "sweep", name) for name in ("global_table.c", "global_wrap.c")]
+
+    rng = random.Random(0)
+    with tempfile.TemporaryDirectory() as tmp:
+        paths = []
+        for i in range(args.inputs):
+            path = os.path.join(tmp, "params%d.txt" % i)
+            with open(path, "w") as f:
+                f.write("%d %d\n" % (rng.randint(-40, 40), rng.randint(-1000, 1000)))
+            paths.append(path)
+        input_list = os.path.join(tmp, "inputs.txt")
+        with open(input_list, "w") as f:
+            f.write("\n".join(paths) + "\n")
+
+        for program in checks:
+            _, expected = run(args.interpreter, program, input_list, ["--engine=ast"])
+            engines = [["--engine=ir"]] + [["--engine=simt", "--lanes=%d" % lanes]
+                                           for lanes in [int(v) for v in args.lanes.split(",")]]
+            for extra in engines:
+                _, got = run(args.interpreter, program, input_list, extra)
+                if got != expected:
+                    sys.exit("%s %s: results differ from the scalar engine"
+                             % (os.path.basename(program), " ".join(extra)))
+            print("agree         %s" % os.path.basename(program))
+
+        base, expected = run(args.interpreter, args.program, input_list, ["--engine=ast"])
+        print("ast           %8.2f s  %8.1f inputs/s" % (base, args.inputs / base))
+        for lanes in [int(v) for v in args.lanes.split(",")]:
+            wall, got = run(args.interpreter, args.program, input_list,
+                            ["--engine=simt", "--lanes=%d" % lanes])
+            if got != expected:
+                sys.exit("--lanes=%d: results differ from the scalar engine" % lanes)
+            print("simt lanes %2d %8.2f s  %8.1f inputs/s  speedup %.2f"
+                  % (lanes, wall, args.inputs / wall, base / wall))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,39 @@
+extern int GET();
+extern void * MALLOC(int);
+extern void FREE(void *);
+extern void PRINT(int);
+
+int weights[8] = {3, 1, 4, 1, 5, 9, 2, 6};
+char tag[8] = "lanes";
+int hist[16];
+int total;
+int * cursor = hist;
+
+int main() {
+   int a;
+   int b;
+   int i;
+   int j;
+   int v;
+
+   a = GET();
+   b = GET();
+   i = 0;
+   while (i < 4000) {
+      v = i * a + b;
+      if (v < 0)
+         v = -v;
+      j = v - (v / 16) * 16;
+      hist[j] = hist[j] + weights[j - (j / 8) * 8];
+      total = total + tag[j - (j / 8) * 8];
+      i = i + 1;
+   }
+   *cursor = *cursor + a;
+   i = 0;
+   while (i < 16) {
+      PRINT(hist[i]);
+      i = i + 1;
+   }
+   PRINT(total);
+   return 0;
+}
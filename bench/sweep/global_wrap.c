@@ -0,0 +1,32 @@
+extern int GET();
+extern void * MALLOC(int);
+extern void FREE(void *);
+extern void PRINT(int);
+
+int total;
+int scale = 65536;
+char small;
+
+int main() {
+   int a;
+   int b;
+   int i;
+   int local;
+
+   a = GET();
+   b = GET();
+   local = 0;
+   i = 0;
+   while (i < 5000) {
+      total = total + a * 1000003 + b;
+      local = local + a * 1000003 + b;
+      small = small + b + i;
+      i = i + 1;
+   }
+   PRINT(total);
+   PRINT(local);
+   PRINT(small);
+   scale = scale * (a + 50) * 1000;
+   PRINT(scale);
+   return 0;
+}
@@ -0,0 +1,47 @@
+extern int GET();
+extern void * MALLOC(int);
+extern void FREE(void *);
+extern void PRINT(int);
+
+int step(int x, int a, int b) {
+   int y;
+   y = (x * a + b) / 16;
+   if (y > 100000)
+      y = y - (y / 100000) * 100000;
+   if (y < -100000)
+      y = y + (-y / 100000) * 100000;
+   return y;
+}
+
+int main() {
+   int h[64];
+   int a;
+   int b;
+   int n;
+   int i;
+   int x;
+   int s;
+
+   a = GET();
+   b = GET();
+   n = 20000;
+   x = 1;
+   s = 0;
+   i = 0;
+   while (i < 64) {
+      h[i] = 0;
+      i = i + 1;
+   }
+   i = 0;
+   while (i < n) {
+      x = step(x, a, b);
+      s = s + x;
+      if (s > 1000000)
+         s = s - 1000000;
+      h[i - (i / 64) * 64] = h[i - (i / 64) * 64] + x;
+      i = i + 1;
+   }
+   PRINT(s);
+   PRINT(h[7]);
+   return 0;
+}
@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+"""Run every testcase against many inputs on many threads and check for races.
+
+Meant for a build configured with -DENABLE_TSAN=ON.  For each program in the
+testcases directory, writes --inputs random input files, runs the program
+once with --inputs on --jobs threads and once on a single thread, and fails
+when ThreadSanitizer reports anything or the two result sets differ.
+
+    tsan_check.py --interpreter build/ast-interpreter [testcases_dir]
+"""
+
+import argparse
+import json
+import os
+import random
+import subprocess
+import sys
+import tempfile
+
+
+def run(interpreter, program, input_list, jobs, timeout):
+    env = dict(os.environ)
+    env.setdefault("TSAN_OPTIONS", "exitcode=66")
+    try:
+        proc = subprocess.run([interpreter, "--inputs=" + input_list, "--jobs=%d" % jobs, program],
+                              stdout=subprocess.PIPE, stderr=subprocess.PIPE, env=env, timeout=timeout)
+    except subprocess.TimeoutExpired:
+        return None, "timed out after %ds" % timeout
+    err = proc.stderr.decode("utf-8", "replace")
+    if "ThreadSanitizer" in err or proc.returncode != 0:
+        return None, "status %d\n%s" % (proc.returncode, err[-4000:])
+    results = []
+    for line in proc.stdout.decode("utf-8").splitlines():
+        result = json.loads(line)
+        del result["wall_ms"]
+        results.append(result)
+    return results, err
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--interpreter", required=True)
+    parser.add_argument("--inputs", type=int, default=16, help="input files per program")
+    parser.add_argument("--jobs", type=int, default=max(2, os.cpu_count() or 1))
+    parser.add_argument("--timeout", type=int, default=300)
+    parser.add_argument("testcases", nargs="?",
+                        default=os.path.join(os.path.dirname(os.path.dirname(os.path.abspath(__file__))),
+                                             "testcases"))
+    args = parser.parse_args()
+
+    rng = random.Random(0)
+    failures = 0
+    with tempfile.TemporaryDirectory() as tmp:
+        inputs = []
+        for i in range(args.inputs):
+            path = os.path.join(tmp, "input%d.txt" % i)
+            with open(path, "w") as f:
+                f.write(" ".join(str(rng.randint(-100, 100)) for _ in range(32)) + "\n")
+            inputs.append(path)
+        input_list = os.path.join(tmp, "inputs.txt")
+        with open(input_list, "w") as f:
+            f.write("\n".join(inputs) + "\n")
+
+        for name in sorted(os.listdir(args.testcases)):
+            if not name.endswith(".c"):
+                continue
+            program = os.path.join(args.testcases, name)
+            parallel, err = run(args.interpreter, program, input_list, args.jobs, args.timeout)
+            if parallel is None:
+                print("FAIL %s --jobs=%d: %s" % (name, args.jobs, err))
+                failures += 1
+                continue
+            serial, err = run(args.interpreter, program, input_list, 1, args.timeout)
+            if serial is None:
+                print("FAIL %s --jobs=1: %s" % (name, err))
+                failures += 1
+            elif serial != parallel:
+                print("FAIL %s: results differ between --jobs=1 and --jobs=%d" % (name, args.jobs))
+                failures += 1
+            else:
+                print("ok   %s" % name)
+    if failures:
+        sys.exit("%d testcases failed" % failures)
+
+
+if __name__ == "__main__":
+    main()